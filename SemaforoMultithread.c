@@ -1,11 +1,23 @@
-#include <stdio.h>
+#include <string.h>
 #include "pico/stdlib.h"
 #include "hardware/pwm.h"
 #include "hardware/i2c.h"
 #include "FreeRTOS.h"
 #include "FreeRTOSConfig.h"
 #include "task.h"
+#include "event_groups.h"
+#include "timers.h"
 #include "led_matrix.h"
+#include "button.h"
+#include "pattern.h"
+#include "signal_plan.h"
+#include "plan_store.h"
+#include "buzzer.h"
+#include "power.h"
+#include "task_monitor.h"
+#include "trace.h"
+#include "protocol.h"
+#include "log.h"
 #include "lib/ssd1306.h"
 #include "lib/font.h"
 
@@ -17,7 +29,6 @@
 #define BUZZER_A 21 
 #define BUZZER_B 10
 // Constantes para a matriz de leds
-#define IS_RGBW false
 #define LED_MATRIX_PIN 7
 // Definições da I2C
 #define I2C_PORT i2c1
@@ -31,33 +42,199 @@ bool cor = true;
 PIO pio;
 uint sm;
 // Variável para indicar qual luz do semáforo está ativa
-uint semaforo_state = 0; // 0: Verde | 1: Amarelo | 2: Vermelho
+volatile uint semaforo_state = 0; // 0: Verde | 1: Amarelo | 2: Vermelho
 // Variáveis do PWM (setado para freq. de 312,5 Hz)
 uint wrap = 2000;
 uint clkdiv = 25;
-// Variáveis para debounce do botão 
-uint32_t last_time = 0; // Armazena o ultimo tempo do botao
-bool last_button_state = false; // Armazena o ultimo estado do botao
+// Tempos do botão A: debounce por timer após a interrupção de borda
+const button_config_t button_a_config = {
+    .debounce_ms = BUTTON_DEBOUNCE_MS,
+    .long_press_ms = BUTTON_LONG_PRESS_MS, // Toque longo: alterna o modo noturno
+    .double_press_ms = 0, // Desativado: o toque simples age na soltura (antes do tempo do toque longo)
+};
 // Variável que controla o modo noturno
-bool night_mode = false;
-// Tempos de cada cor no semáforo (em ms)
-const uint green_time = 15000;
-const uint yellow_time = 5000;
-const uint red_time = 10000;
-// Booleano para a ativação do buzzer verde
-bool buzzer_green = true;
+volatile bool night_mode = false;
+// Eventos de mudança de estado: um bit por task consumidora, todos ativados a cada mudança
+EventGroupHandle_t state_events;
+StaticEventGroup_t state_events_buffer;
+#define EVT_DISPLAY (1 << 0)
+#define EVT_MATRIX  (1 << 1)
+#define EVT_ALL     (EVT_DISPLAY | EVT_MATRIX)
+#define EVT_TIMER   (1 << 2) // Acorda o controlador numa troca de modo
+#define EVT_PEDESTRE (1 << 3) // Acorda o controlador numa chamada de pedestre
+// Afinidade das tasks: temporização, entrada e saídas PWM num core, renderização no outro
+#define CORE_CONTROLE  (1 << 0)
+#define CORE_INTERFACE (1 << 1)
+// Stacks das tasks (em palavras), todas alocadas estaticamente. Os 256 são os tamanhos herdados
+// da versão com heap, ainda não medidos: nenhum soak foi feito. Para dimensioná-las, rodar um build
+// com SEMAFORO_STACK_REPORT na placa e usar o tamanho sugerido (pico + TASK_MONITOR_MARGIN_PCT).
+// Até lá, um estouro para o firmware pelo vApplicationStackOverflowHook (configCHECK_FOR_STACK_OVERFLOW).
+// O simulador (sim/) redefine os tamanhos: as threads da porta POSIX exigem stacks maiores.
+#ifndef STACK_TIMER_SEMAFORO
+#define STACK_TIMER_SEMAFORO 256
+#define STACK_DISPLAY 256
+#define STACK_MATRIX 256
+#endif
+StackType_t stack_timer_semaforo[STACK_TIMER_SEMAFORO];
+StackType_t stack_display[STACK_DISPLAY];
+StackType_t stack_matrix[STACK_MATRIX];
+StaticTask_t tcb_timer_semaforo;
+StaticTask_t tcb_display;
+StaticTask_t tcb_matrix;
+#ifdef SEMAFORO_LATENCY_STATS
+// Pior latência de transição de fase observada: do prazo até os novos padrões aplicados (us)
+uint32_t transicao_pior_us = 0;
+// Prazo armado pelo controlador e o instante (time_us_32) em que o tick dele aconteceu, marcado pelo tick hook
+volatile TickType_t latencia_prazo;
+volatile uint32_t latencia_prazo_us;
+volatile bool latencia_prazo_marcado = false;
+#endif
+// Grupos de sinal do cruzamento. O LED RGB, o display, a matriz e os buzzers da placa
+// mostram o GRUPO_PLACA; os demais saem só no trace (TRACE_GRUPO).
+#define VIA_PRINCIPAL 0
+#define VIA_TRANSVERSAL 1
+#define PEDESTRE 2 // Travessia da via principal
+#define GRUPO_PLACA VIA_PRINCIPAL
+// Atuação de pedestres: o toque no botão A registra uma chamada, que encurta o verde do
+// GRUPO_ATUADO respeitando o verde mínimo e a espera máxima até a travessia abrir
+#define GRUPO_ATUADO VIA_PRINCIPAL
+#define VERDE_MINIMO_MS 5000
+#define ESPERA_MAXIMA_MS 12000
+typedef struct {
+    bool pendente;            // Chamada registrada e ainda não atendida pela travessia
+    TickType_t toque;         // Tick do primeiro toque (os seguintes não mudam a espera)
+    uint64_t toque_us;
+    uint64_t troca_us;        // Fim do verde veicular após o toque (0 se o toque veio fora do verde)
+    uint32_t reacao_us;       // Do toque até o controlador tratar a chamada
+    // Estatísticas das chamadas atendidas
+    uint32_t atendidas;
+    uint64_t espera_soma_ms;
+    uint32_t espera_pior_ms;
+    uint32_t reacao_pior_us;
+} Atuacao;
+// O registro da chamada (task de timers) e o controlador usam seção crítica nos campos da chamada
+Atuacao atuacao;
+// Planos padrão, usados enquanto a flash não tiver uma imagem válida (plan_store.h). A imagem
+// tem o mesmo layout da gravada na flash, então o controlador não distingue as duas origens.
+// Novas aproximações são novas colunas (grupos) e linhas (intervalos) da tabela.
+#define PLANOS_PADRAO 2
+#define INTERVALOS_PADRAO 14
+#define HORARIOS_PADRAO 4
+typedef struct {
+    plan_store_header_t cabecalho;
+    plan_store_plan_t planos[PLANOS_PADRAO];
+    plan_interval_t intervalos[INTERVALOS_PADRAO];
+    plan_store_schedule_t horarios[HORARIOS_PADRAO];
+} PlanosPadrao;
+const PlanosPadrao planos_padrao = {
+    .cabecalho = {
+        .magic = PLAN_STORE_MAGIC, .formato = PLAN_STORE_FORMAT, .tamanho = sizeof(PlanosPadrao),
+        .num_planos = PLANOS_PADRAO, .num_intervalos = INTERVALOS_PADRAO, .num_horarios = HORARIOS_PADRAO,
+    },
+    .planos = {
+        {0, 7, 3}, // Plano 0 (normal), na via principal: verde 15s, amarelo 5s e vermelho 10s
+        {7, 7, 3}, // Plano 1 (pico): verde da via principal estendido para 25s
+    },
+    .intervalos = {
+        // Estágio 1: via principal
+        {PLAN_GROUP(VIA_PRINCIPAL, SIGNAL_GREEN), 15000},
+        {PLAN_GROUP(VIA_PRINCIPAL, SIGNAL_YELLOW), 5000},
+        {0, 1000}, // Limpeza: todos no vermelho
+        // Estágio 2: via transversal, com a travessia de pedestres da principal
+        {PLAN_GROUP(VIA_TRANSVERSAL, SIGNAL_GREEN) | PLAN_GROUP(PEDESTRE, SIGNAL_GREEN), 4000},
+        {PLAN_GROUP(VIA_TRANSVERSAL, SIGNAL_GREEN) | PLAN_GROUP(PEDESTRE, SIGNAL_FLASH), 2000},
+        {PLAN_GROUP(VIA_TRANSVERSAL, SIGNAL_YELLOW), 2000},
+        {0, 1000}, // Limpeza
+
+        {PLAN_GROUP(VIA_PRINCIPAL, SIGNAL_GREEN), 25000},
+        {PLAN_GROUP(VIA_PRINCIPAL, SIGNAL_YELLOW), 5000},
+        {0, 1000},
+        {PLAN_GROUP(VIA_TRANSVERSAL, SIGNAL_GREEN) | PLAN_GROUP(PEDESTRE, SIGNAL_GREEN), 4000},
+        {PLAN_GROUP(VIA_TRANSVERSAL, SIGNAL_GREEN) | PLAN_GROUP(PEDESTRE, SIGNAL_FLASH), 2000},
+        {PLAN_GROUP(VIA_TRANSVERSAL, SIGNAL_YELLOW), 2000},
+        {0, 1000},
+    },
+    .horarios = {
+        {7 * 60, 1}, {9 * 60, 0}, {17 * 60, 1}, {19 * 60, 0},
+    },
+};
+// Relógio do dia em software: sem RTC, o boot é tomado como RELOGIO_INICIO_MIN
+#define RELOGIO_INICIO_MIN (6 * 60)
+volatile uint relogio_inicio_min = RELOGIO_INICIO_MIN;
+// Plano em execução: o descritor aponta para os intervalos dentro da imagem ativa (sem cópia)
+const plan_store_header_t *imagem_planos;
+uint indice_plano;
+plan_t plano_atual;
+plan_runner_t plano_exec;
+// Estado da placa (semaforo_state) para cada signal_state_t do GRUPO_PLACA
+const uint estado_placa[] = {2, 0, 1, 2}; // Vermelho | Verde | Amarelo | Piscante (só pedestres)
+// Fase atual publicada pelo controlador: as tasks calculam o tempo restante a partir dela.
+// Leitura e escrita em seção crítica, que no SMP também trava o outro core.
+typedef struct {
+    uint estado;          // Mesmo valor do semaforo_state
+    TickType_t inicio;    // Tick de início da fase (prazo absoluto, sem deriva)
+    TickType_t duracao;   // Duração da fase em ticks
+} Fase;
+Fase fase_atual;
+// Canais do sequenciador de padrões do LED RGB (vermelho e verde)
+pattern_channel_t canal_led_red;
+pattern_channel_t canal_led_green;
+// Padrões de cada estado (índices 0-2 seguem o semaforo_state, 3 é o modo noturno)
+#define NIVEL_ON 5 // Nível dos LEDs (% do wrap) e duty dos tons dos buzzers quando ativos
+#define SINAL_NOTURNO 3
+typedef struct {
+    pattern_t led_red;
+    pattern_t led_green; // Amarelo = vermelho + verde
+    buzzer_tone_t tom_a; // Tons gerados pela PIO: frequência própria por fase e por buzzer
+    buzzer_tone_t tom_b;
+} Sinalizacao;
+const Sinalizacao sinalizacao[4] = {
+    // Verde: beep de 1s no início da fase, em intervalo de quinta (880/1320 Hz)
+    {PATTERN({0, 0}), PATTERN({NIVEL_ON, 0}),
+     BUZZER_TONE(880, NIVEL_ON, 1000, 0), BUZZER_TONE(1320, NIVEL_ON, 1000, 0)},
+    // Amarelo: beep agudo intermitente 250ms on/250ms off
+    {PATTERN({NIVEL_ON, 0}), PATTERN({NIVEL_ON, 0}),
+     BUZZER_TONE(1500, NIVEL_ON, 250, 250), BUZZER_TONE(1500, NIVEL_ON, 250, 250)},
+    // Vermelho: beep grave 500ms on/1500ms off
+    {PATTERN({NIVEL_ON, 0}), PATTERN({0, 0}),
+     BUZZER_TONE(440, NIVEL_ON, 500, 1500), BUZZER_TONE(660, NIVEL_ON, 500, 1500)},
+    // Noturno: amarelo piscando 2s on/2s off e beep de 200ms a cada 4s
+    {PATTERN({NIVEL_ON, 2000}, {0, 2000}), PATTERN({NIVEL_ON, 2000}, {0, 2000}),
+     BUZZER_TONE(700, NIVEL_ON, 200, 3800), BUZZER_TONE(700, NIVEL_ON, 200, 3800)},
+};
 // Index do frame que será exibido na matriz de leds
 uint green_frame_index = 0;
 // Intensidade da cor na matriz de leds (funciona apenas para vermelho e amarelo)
 int matrix_intensity_step = 10;
 bool matrix_intensity_rising = false;
+#ifdef SEMAFORO_LOW_POWER
+// Fase do pisca da matriz no modo noturno de baixo consumo
+bool matrix_blink_apagado = false;
+#endif
+// Escalas máximas (Q16) do pulso na matriz de leds
+#define MATRIX_YELLOW_MAX LED_SCALE(0.10)
+#define MATRIX_RED_MAX LED_SCALE(0.05)
 // String para armazenar o tempo restante do semáforo
 char converted_num; // Armazena um dígito
 char converted_string[3]; // Armazena o número convertido (2 dígitos)
-// Contadores para o display
-uint green_count = green_time/1000;
-uint yellow_count = yellow_time/1000;
-uint red_count = red_time/1000;
+// Textos de cada tela do display (índices 0-2 seguem o semaforo_state)
+typedef struct {
+    const char *modo;
+    const char *cor;
+    const char *mensagem;
+} Tela;
+#define TELA_NOTURNO 3
+#define NUM_TELAS 4
+const Tela telas[NUM_TELAS] = {
+    {"NORMAL", "VERDE", "LIBERADO"},
+    {"NORMAL", "AMARELO", "ATENCAO"},
+    {"NORMAL", "VERMELHA", "PARE!"},
+    {"NOTURNO", "AMARELO", "ATENCAO"},
+};
+// Camadas pré-renderizadas do display: um frame completo (moldura e textos fixos) por tela
+uint8_t display_layers[NUM_TELAS][SSD1306_BUFFER_SIZE];
+ssd1306_buffers_t display_buffers; // Frame buffer e buffers de envio do display, sem heap
+#define DISPLAY_CONTRASTE_NOTURNO 0x10 // Brilho do display no modo noturno
 
 
 // FUNÇÕES AUXILIARES =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
@@ -94,182 +271,492 @@ void int_2_string(int num){
     }
 }
 
+// Desenha os elementos fixos do display (moldura, título e rótulos)
+void desenha_moldura(ssd1306_t *ssd){
+    // Frame que será reutilizado para todos
+    ssd1306_rect(ssd, 0, 0, 128, 64, cor, !cor);
+    // Nome superior
+    ssd1306_rect(ssd, 0, 0, 128, 12, cor, cor); // Fundo preenchido
+    ssd1306_draw_string(ssd, "SEMAFORO", 4, 3, true); // String: Semaforo
+    ssd1306_draw_string(ssd, "TM", 107, 3, true);
+    // Modo
+    ssd1306_draw_string(ssd, "MODO:", 4, 16, false);
+    // Cor
+    ssd1306_draw_string(ssd, "COR:", 4, 28, false);
+    // Borda do tempo
+    ssd1306_rect(ssd, 48, 100, 26, 8, cor, !cor);
+}
 
-// TASKS UTILIZADAS NO CÓDIGO =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
-// Task para controlar a temporização do semáforo
-void vTimerSemaforoTask(){
-    while(true){
-        red_count = red_time/1000; // Reseta o contador vermelho do display
-        green_count = green_time/1000; // Reseta o contador verde do display
-        yellow_count = yellow_time/1000; // Reseta o contador amarelo do display
-            
-        semaforo_state = 0;
-        vTaskDelay(pdMS_TO_TICKS(green_time));
+// Troca os padrões do LED RGB e os tons dos buzzers (executada na task de timers, junto com o sequenciador)
+void atualiza_sinalizacao(void *param, uint32_t param2){
+    const Sinalizacao *sinal = &sinalizacao[night_mode ? SINAL_NOTURNO : semaforo_state];
+    pattern_set(&canal_led_red, &sinal->led_red);
+    pattern_set(&canal_led_green, &sinal->led_green);
+    buzzer_play((const buzzer_tone_t *[BUZZER_CHANNELS]){&sinal->tom_a, &sinal->tom_b});
+#ifdef SEMAFORO_LATENCY_STATS
+    // Saídas já trocadas: a latência vai do tick do prazo até aqui, com a task de timers e o envio
+    // do display disputando os cores. Trocas fora de um prazo (modo, chamada) não têm marca.
+    if(latencia_prazo_marcado){
+        latencia_prazo_marcado = false;
+        uint32_t latencia = time_us_32() - latencia_prazo_us;
+        if(latencia > transicao_pior_us){
+            transicao_pior_us = latencia;
+            LOG_RATE(1000, "(LATENCY) transicao de fase: pior caso %lu us\n", latencia);
+        }
+    }
+#endif
+}
 
-        semaforo_state = 1;
-        vTaskDelay(pdMS_TO_TICKS(yellow_time));
+#ifdef SEMAFORO_LATENCY_STATS
+// Marca o instante do tick em que o prazo do controlador vence (ISR do tick, no core do tick)
+void vApplicationTickHook(void){
+    if(xTaskGetTickCountFromISR() == latencia_prazo){
+        latencia_prazo_us = time_us_32();
+        latencia_prazo_marcado = true;
+    }
+}
+#endif
 
-        semaforo_state = 2;
-        vTaskDelay(pdMS_TO_TICKS(red_time));
+// Avisa todas as saídas que o estado do semáforo (cor ou modo) mudou
+void publica_estado(){
+    // Os padrões são lidos e trocados na task de timers, em ordem com o avanço dos passos
+    if(xTaskGetCurrentTaskHandle() == xTimerGetTimerDaemonTaskHandle()){
+        atualiza_sinalizacao(NULL, 0);
+    }
+    else{
+        xTimerPendFunctionCall(atualiza_sinalizacao, NULL, 0, portMAX_DELAY);
+    }
+    xEventGroupSetBits(state_events, EVT_ALL);
+}
 
-        buzzer_green = true; // Engatilha o buzzer da luz verde novamente
+// Publica o início de uma nova fase (cor, tick de início e duração) e avisa as tasks de saída
+void publica_fase(uint estado, TickType_t inicio, TickType_t duracao){
+    taskENTER_CRITICAL();
+    fase_atual.estado = estado;
+    fase_atual.inicio = inicio;
+    fase_atual.duracao = duracao;
+    semaforo_state = estado;
+    taskEXIT_CRITICAL();
+    trace_log(TRACE_FASE, estado);
+    publica_estado();
+}
+
+// Cópia consistente da fase atual
+Fase le_fase(){
+    taskENTER_CRITICAL();
+    Fase fase = fase_atual;
+    taskEXIT_CRITICAL();
+    return fase;
+}
+
+// Ticks restantes da fase, calculados a partir do tick de início publicado
+TickType_t tempo_restante(const Fase *fase){
+    TickType_t decorrido = xTaskGetTickCount() - fase->inicio;
+    return decorrido < fase->duracao ? fase->duracao - decorrido : 0;
+}
+
+// Chamada atendida: a travessia abriu. Registra a espera do pedestre e imprime o relatório.
+void conclui_chamada(){
+    taskENTER_CRITICAL();
+    bool pendente = atuacao.pendente;
+    atuacao.pendente = false;
+    taskEXIT_CRITICAL();
+    if(!pendente){
+        return;
+    }
+    uint64_t agora = time_us_64();
+    uint32_t espera_ms = (agora - atuacao.toque_us) / 1000;
+    uint32_t troca_ms = atuacao.troca_us ? (atuacao.troca_us - atuacao.toque_us) / 1000 : 0;
+    atuacao.atendidas++;
+    atuacao.espera_soma_ms += espera_ms;
+    if(espera_ms > atuacao.espera_pior_ms){
+        atuacao.espera_pior_ms = espera_ms;
     }
+    if(atuacao.reacao_us > atuacao.reacao_pior_us){
+        atuacao.reacao_pior_us = atuacao.reacao_us;
+    }
+    trace_log(TRACE_PEDESTRE, espera_ms < UINT16_MAX ? espera_ms : UINT16_MAX);
+    LOG("(PED) espera %lu ms, fim do verde %lu ms apos o toque, reacao %lu us\n", espera_ms, troca_ms, atuacao.reacao_us);
+    LOG("(PED) %lu chamadas, espera media %lu ms, pior %lu ms, pior reacao %lu us\n", atuacao.atendidas,
+        (uint32_t)(atuacao.espera_soma_ms / atuacao.atendidas), atuacao.espera_pior_ms, atuacao.reacao_pior_us);
 }
 
-// Task para leitura do botão A
-void vReadButtonTask(){
-    // Iniciando o pino do Botão A para as leituras
-    gpio_init(BUTTON_A);
-    gpio_set_dir(BUTTON_A, GPIO_IN);
-    gpio_pull_up(BUTTON_A);
+// Saída dos grupos de sinal, chamada pelo plano a cada troca de estado de um grupo
+void saida_grupo(const plan_runner_t *r, uint grupo, signal_state_t estado){
+    trace_log(TRACE_GRUPO, grupo << 8 | estado);
+    if(grupo == GRUPO_PLACA){
+        // A fase da placa dura enquanto o grupo não muda, mesmo atravessando vários intervalos
+        publica_fase(estado_placa[estado], r->inicio, plan_group_duration(r, grupo));
+    }
+    if(grupo == GRUPO_ATUADO && estado != SIGNAL_GREEN && atuacao.pendente && !atuacao.troca_us){
+        atuacao.troca_us = time_us_64();
+    }
+    if(grupo == PEDESTRE && estado == SIGNAL_GREEN){
+        conclui_chamada();
+    }
+}
 
-    while(true){
-        uint32_t current_time = to_us_since_boot(get_absolute_time()); // Pega o tempo atual (em us)
-        bool current_button_state = gpio_get(BUTTON_A); // Pega o estado atual do botao
+// Registra uma chamada de pedestre (executado na task de timers) e acorda o controlador
+void registra_chamada(){
+    taskENTER_CRITICAL();
+    bool nova = !atuacao.pendente;
+    if(nova){
+        atuacao.pendente = true;
+        atuacao.toque = xTaskGetTickCount();
+        atuacao.toque_us = time_us_64();
+        atuacao.troca_us = 0;
+        atuacao.reacao_us = 0;
+    }
+    taskEXIT_CRITICAL();
+    if(nova){
+        trace_log(TRACE_PEDESTRE, 0);
+        xEventGroupSetBits(state_events, EVT_PEDESTRE);
+    }
+}
 
-        if(!current_button_state && last_button_state && (current_time - last_time > 200000)){ // Pegando a borda de descida com debounce de 200ms
-            last_time = current_time; // Atualiza o ultimo tempo
-            night_mode = !night_mode; // Alterna o flag do modo noturno
+// Encurta o verde do GRUPO_ATUADO para atender a chamada pendente. Ele termina o mais tarde
+// possível sem passar da espera máxima até a travessia, mas nunca antes do verde mínimo
+// (contado do início do intervalo). Fora do verde, a chamada espera o plano ou o próximo verde.
+void aplica_chamada(){
+    taskENTER_CRITICAL();
+    bool pendente = atuacao.pendente;
+    TickType_t toque = atuacao.toque;
+    uint64_t toque_us = atuacao.toque_us;
+    taskEXIT_CRITICAL();
+    if(!pendente){
+        return;
+    }
+    if(!atuacao.reacao_us){
+        uint64_t reacao = time_us_64() - toque_us;
+        atuacao.reacao_us = reacao ? reacao : 1;
+    }
+    if(plan_group_state(&plano_exec, PEDESTRE) == SIGNAL_GREEN){
+        conclui_chamada(); // Travessia já aberta
+        return;
+    }
+    TickType_t ate_travessia = plan_time_until(&plano_exec, PEDESTRE, SIGNAL_GREEN);
+    if(plan_group_state(&plano_exec, GRUPO_ATUADO) != SIGNAL_GREEN || ate_travessia == portMAX_DELAY){
+        return;
+    }
+    TickType_t prazo = toque + pdMS_TO_TICKS(ESPERA_MAXIMA_MS) - ate_travessia;
+    TickType_t minimo = plano_exec.inicio + pdMS_TO_TICKS(VERDE_MINIMO_MS);
+    if((int32_t)(minimo - prazo) > 0){
+        prazo = minimo;
+    }
+    if(plan_shorten(&plano_exec, prazo)){
+        // Republica o verde com a nova duração: o display recalcula o tempo restante e o
+        // bipe do verde se repete, confirmando a chamada
+        plano_exec.saida(&plano_exec, GRUPO_ATUADO, SIGNAL_GREEN);
+    }
+}
 
-            // Logs para indicar o modo que está agora
-            if(night_mode){
-                printf("(MODE) NIGHT\n");
-            }
-            else{
-                printf("(MODE) NORMAL\n");
-                semaforo_state = 0; // Na volta para o modo normal retorna para a cor verde
-                green_frame_index=0; // Retorna para o frame 0 da animação da luz verde
-                matrix_intensity_step=10; // Retorna para 10% de intensidade na matriz de leds (cores vermelho e amarelo)
-                matrix_intensity_rising=false; // Indica que a intensidade tem que descer
-                buzzer_green = true; // Engatilha o buzzer da luz verde
-            }
-        }
+// Descarta a chamada pendente (entrada no modo noturno)
+void descarta_chamada(){
+    taskENTER_CRITICAL();
+    atuacao.pendente = false;
+    taskEXIT_CRITICAL();
+}
+
+// Minuto do dia pelo relógio em software (o contador de 64 bits em us não volta)
+uint minuto_do_dia(){
+    return (relogio_inicio_min + time_us_64() / 60000000u) % PLAN_STORE_MINUTES_PER_DAY;
+}
+
+// Começa em inicio o plano do horário, lido da imagem ativa
+void inicia_plano(TickType_t inicio){
+    imagem_planos = plan_store_acquire();
+    indice_plano = plan_store_select(imagem_planos, minuto_do_dia());
+    plan_store_get(imagem_planos, indice_plano, &plano_atual);
+    plan_start(&plano_exec, &plano_atual, inicio, saida_grupo);
+}
+
+// O plano em execução deixa de valer se a imagem na flash foi regravada ou se o horário mudou
+bool plano_desatualizado(){
+    return plan_store_active() != imagem_planos || plan_store_select(imagem_planos, minuto_do_dia()) != indice_plano;
+}
 
-        last_button_state = current_button_state; // Atualiza o ultimo estado do botão A
-        vTaskDelay(pdMS_TO_TICKS(100)); // Delay de 100ms para reduzir o uso de CPU
+// Espera o controlador até o tick absoluto prazo. Retorna os eventos que o acordaram antes
+// (troca de modo ou chamada de pedestre), ou 0 no prazo.
+EventBits_t aguarda_prazo(TickType_t prazo){
+    TickType_t espera = prazo - xTaskGetTickCount();
+    if((int32_t)espera <= 0){
+        return 0; // Prazo já vencido
     }
+    return xEventGroupWaitBits(state_events, EVT_TIMER | EVT_PEDESTRE, pdTRUE, pdFALSE, espera) & (EVT_TIMER | EVT_PEDESTRE);
 }
 
-// Task para controlar o LED RGB do semáforo
-void vLedsRGBSemaforoTask(){
-    // Ativando o PWM do LED RGB com 0% de DC
-    set_pwm(LED_RED, wrap);
-    set_pwm(LED_GREEN, wrap);
-    set_pwm(LED_BLUE, wrap);
+// Bloqueia até uma mudança de estado ou até o timeout. Retorna true se o estado mudou.
+bool aguarda_evento(EventBits_t bit, TickType_t timeout){
+    return (xEventGroupWaitBits(state_events, bit, pdTRUE, pdFALSE, timeout) & bit) != 0;
+}
+
+// Espera o próximo frame da animação da matriz; numa mudança de estado a animação recomeça
+void aguarda_frame_matriz(uint ms){
+    if(aguarda_evento(EVT_MATRIX, pdMS_TO_TICKS(ms))){
+        green_frame_index = 0; // Retorna para o frame 0 da animação da luz verde
+        matrix_intensity_step = 10; // Retorna para 10% de intensidade na matriz de leds (cores vermelho e amarelo)
+        matrix_intensity_rising = false; // Indica que a intensidade tem que descer
+#ifdef SEMAFORO_LOW_POWER
+        matrix_blink_apagado = false; // O pisca recomeça aceso, junto com o LED RGB
+#endif
+    }
+}
+
+// Ajusta o painel ao modo: no noturno ele é escurecido, ou desligado junto com o charge pump
+// no build de baixo consumo (a GDDRAM é mantida e o frame volta ao religar)
+void display_modo_noturno(ssd1306_t *ssd, bool noturno){
+#ifdef SEMAFORO_LOW_POWER
+    ssd1306_power(ssd, !noturno);
+#else
+    ssd1306_contrast(ssd, noturno ? DISPLAY_CONTRASTE_NOTURNO : 0xFF);
+#endif
+}
 
-    float led_luminosity = 0.05; // Intensidade dos LEDs
+// Cria uma task com stack estática e afinidade de core (no build de um core só, a afinidade é ignorada)
+void cria_task(TaskFunction_t task, const char *nome, StackType_t *stack, uint32_t stack_words, StaticTask_t *tcb, UBaseType_t core){
+#if configUSE_CORE_AFFINITY
+    TaskHandle_t handle = xTaskCreateStaticAffinitySet(task, nome, stack_words, NULL, tskIDLE_PRIORITY, stack, tcb, core);
+#else
+    TaskHandle_t handle = xTaskCreateStatic(task, nome, stack_words, NULL, tskIDLE_PRIORITY, stack, tcb);
+#endif
+    task_monitor_register(handle, stack_words);
+}
+
+// Callback da DMA do display: notifica a task que iniciou o envio
+void display_flush_done(void *ctx){
+    BaseType_t higher_priority_woken = pdFALSE;
+    vTaskNotifyGiveFromISR((TaskHandle_t)ctx, &higher_priority_woken);
+    portYIELD_FROM_ISR(higher_priority_woken);
+}
+
+
+// TASKS UTILIZADAS NO CÓDIGO =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Task para controlar a temporização do semáforo: um único prazo avança todos os grupos do plano.
+// Os prazos são absolutos (início + duração), então o atraso de uma task não se acumula
+void vTimerSemaforoTask(){
+    bool reinicia = true;
 
     while(true){
-        // Ações do modo noturno do semáforo
+        // No modo noturno o plano fica parado; na volta, recomeça do primeiro intervalo a partir de agora
         if(night_mode){
-            semaforo_state = 0; // Atualiza continuamente para o clico de cor verde do semáforo
-            // Alterna 2s on/2s of
-            // Amarelo = 0.5*verde + 0.5*vermelho
-            pwm_set_gpio_level(LED_GREEN, led_luminosity*wrap);
-            pwm_set_gpio_level(LED_RED, led_luminosity*wrap);
-            vTaskDelay(pdMS_TO_TICKS(2000));
-            pwm_set_gpio_level(LED_GREEN, 0);
-            pwm_set_gpio_level(LED_RED, 0);
-            vTaskDelay(pdMS_TO_TICKS(2000));
+            plan_store_release(); // Libera o setor da imagem para uma nova gravação
+            aguarda_evento(EVT_TIMER, portMAX_DELAY);
+            reinicia = true;
+            continue;
+        }
+        if(reinicia){
+            inicia_plano(xTaskGetTickCount());
+            reinicia = false;
+        }
+        // Uma chamada pendente encurta o verde em andamento, ou o próximo logo que ele começa
+        aplica_chamada();
+
+#ifdef SEMAFORO_LATENCY_STATS
+        latencia_prazo_marcado = false;
+        latencia_prazo = plan_deadline(&plano_exec);
+#endif
+        // Equivalente a xTaskDelayUntil até o fim do intervalo, mas interrompível pela troca de
+        // modo e pelas chamadas de pedestre (que recalculam o prazo)
+        EventBits_t eventos = aguarda_prazo(plan_deadline(&plano_exec));
+        if(eventos & EVT_TIMER){
+            reinicia = true;
+            continue;
+        }
+        if(eventos & EVT_PEDESTRE){
+            continue;
+        }
+        // A troca de plano (horário ou nova imagem) só acontece no fim do ciclo, após a limpeza
+        if(plan_cycle_end(&plano_exec) && plano_desatualizado()){
+            inicia_plano(plan_deadline(&plano_exec));
+            LOG("(PLAN) plano %lu, versao %lu\n", indice_plano, imagem_planos->versao);
         }
-        // Modo normal do semáforo
         else{
-            switch(semaforo_state){
-                // Cor VERDE
-                case 0:
-                    pwm_set_gpio_level(LED_RED, 0);
-                    pwm_set_gpio_level(LED_GREEN, led_luminosity*wrap);
-                    pwm_set_gpio_level(LED_BLUE, 0);
-                    break;
-                
-                // Cor AMARELA
-                case 1:
-                    pwm_set_gpio_level(LED_RED, led_luminosity*wrap);
-                    pwm_set_gpio_level(LED_GREEN, led_luminosity*wrap);
-                    pwm_set_gpio_level(LED_BLUE, 0);
-                    break;
-    
-                // Cor VERMELHA
-                case 2:
-                    pwm_set_gpio_level(LED_RED, led_luminosity*wrap);
-                    pwm_set_gpio_level(LED_GREEN, 0);
-                    pwm_set_gpio_level(LED_BLUE, 0);
-                    break;
-            }
+            plan_advance(&plano_exec);
         }
+    }
+}
+
+// Troca o modo (botão ou protocolo). O teste e a troca ficam na mesma seção crítica, então
+// dois pedidos simultâneos não se anulam.
+void define_modo_noturno(bool noturno){
+    taskENTER_CRITICAL();
+    bool muda = night_mode != noturno;
+    night_mode = noturno;
+    taskEXIT_CRITICAL();
+    if(!muda){
+        return;
+    }
+    trace_log(TRACE_MODO, noturno);
 
-        vTaskDelay(10);
+    // Logs para indicar o modo que está agora
+    if(noturno){
+        descarta_chamada(); // Não há travessia a chamar no modo noturno
+        LOG("(MODE) NIGHT\n");
+        publica_estado(); // As tasks de saída reagem à troca de modo imediatamente
+    }
+    else{
+        LOG("(MODE) NORMAL\n");
     }
+    // Interrompe a fase em andamento; na volta ao modo normal o controlador recomeça
+    // o plano pelo primeiro intervalo e publica a nova fase
+    xEventGroupSetBits(state_events, EVT_TIMER);
 }
 
+// Eventos do botão A (executado na task de timers, após o debounce): o toque é uma chamada de
+// pedestre e o toque longo alterna o modo noturno
+void trata_botao_a(button_event_t evento){
+    if(evento == BUTTON_EVT_PRESS){
+        if(!night_mode){ // No modo noturno não há travessia a chamar
+            registra_chamada();
+        }
+        return;
+    }
+    if(evento == BUTTON_EVT_LONG_PRESS){
+        define_modo_noturno(!night_mode);
+    }
+}
 
-// Task para controlar o buzzer
-void vBuzzerTask(){
-    // Iniciando o PWM dos buzzers
-    set_pwm(BUZZER_A, wrap);
-    set_pwm(BUZZER_B, wrap);
+// COMANDOS DO PROTOCOLO =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Executados na task do protocolo (lib/protocol.h), fora das tasks de temporização. Cliente de
+// referência em tools/protocol_client.py, com os mesmos layouts das respostas.
+#define CMD_ESTADO 0x01
+#define CMD_CONTADORES 0x02
+#define CMD_MODO_NOTURNO 0x03    // dados: 1 noturno, 0 normal
+#define CMD_PLANO_INTERVALO 0x04 // dados: plano, intervalo, duração em ms (uint32)
+#define CMD_RELOGIO 0x05         // dados: minuto do dia (uint16)
+#define CMD_TRACE 0x06           // Dump do trace em texto, antes da resposta (build com SEMAFORO_TRACE)
+
+typedef struct {
+    uint8_t noturno;
+    uint8_t fase;              // Mesmo valor do semaforo_state
+    uint8_t plano;
+    uint8_t intervalo;
+    uint32_t restante_ms;      // Tempo restante da fase da placa
+    uint32_t estados;          // Estados de todos os grupos, 2 bits por grupo (signal_state_t)
+    uint32_t versao_planos;
+    uint32_t tempo_ms;         // Desde o boot
+    uint16_t minuto_dia;
+    uint16_t chamada;          // 1 com uma chamada de pedestre pendente
+} RespostaEstado;
+
+typedef struct {
+    uint32_t chamadas;         // Chamadas de pedestre atendidas
+    uint32_t espera_media_ms;
+    uint32_t espera_pior_ms;
+    uint32_t reacao_pior_us;
+    uint32_t transicao_pior_us; // Só no build com SEMAFORO_LATENCY_STATS (0 sem ele)
+} RespostaContadores;
+
+// Imagem montada para gravar na flash (a ativa com a alteração pedida)
+uint32_t imagem_nova[PLAN_STORE_MAX_BYTES / sizeof(uint32_t)];
+
+// Leituras sem trava das variáveis do controlador: é telemetria, e cada campo é uma palavra
+protocol_status_t cmd_estado(const uint8_t *dados, uint tamanho, uint8_t *resposta, uint *tamanho_resposta){
+    Fase fase = le_fase();
+    RespostaEstado estado = {
+        .noturno = night_mode,
+        .fase = fase.estado,
+        .plano = indice_plano,
+        .intervalo = plano_exec.intervalo,
+        .restante_ms = tempo_restante(&fase) * portTICK_PERIOD_MS,
+        .estados = plano_exec.estados,
+        .versao_planos = plan_store_active()->versao,
+        .tempo_ms = time_us_64() / 1000,
+        .minuto_dia = minuto_do_dia(),
+        .chamada = atuacao.pendente,
+    };
+    memcpy(resposta, &estado, sizeof(estado));
+    *tamanho_resposta = sizeof(estado);
+    return PROTOCOL_OK;
+}
 
-    // Booleano que indica quando deve ter o buzzer do sinal verde
-    buzzer_green = true;
+protocol_status_t cmd_contadores(const uint8_t *dados, uint tamanho, uint8_t *resposta, uint *tamanho_resposta){
+    RespostaContadores contadores = {
+        .chamadas = atuacao.atendidas,
+        .espera_media_ms = atuacao.atendidas ? atuacao.espera_soma_ms / atuacao.atendidas : 0,
+        .espera_pior_ms = atuacao.espera_pior_ms,
+        .reacao_pior_us = atuacao.reacao_pior_us,
+#ifdef SEMAFORO_LATENCY_STATS
+        .transicao_pior_us = transicao_pior_us,
+#endif
+    };
+    memcpy(resposta, &contadores, sizeof(contadores));
+    *tamanho_resposta = sizeof(contadores);
+    return PROTOCOL_OK;
+}
 
-    while(true){
+protocol_status_t cmd_modo_noturno(const uint8_t *dados, uint tamanho, uint8_t *resposta, uint *tamanho_resposta){
+    if(tamanho != 1 || dados[0] > 1){
+        return PROTOCOL_ERR_ARGS;
+    }
+    define_modo_noturno(dados[0]);
+    return PROTOCOL_OK;
+}
 
-        // Modo noturno
-        if(night_mode){
-            // Aciona os buzzers durante 200ms
-            pwm_set_gpio_level(BUZZER_A, wrap*0.05);
-            pwm_set_gpio_level(BUZZER_B, wrap*0.05);
-            vTaskDelay(pdMS_TO_TICKS(200));
-            // Desativa ambos e espera 3600ms
-            pwm_set_gpio_level(BUZZER_A, 0);
-            pwm_set_gpio_level(BUZZER_B, 0);
-            vTaskDelay(pdMS_TO_TICKS(3800));
-            bool buzzer_green = true ; // Deixa o buzzer pronto para ser acionado na cor verde
-        }
-        // Modo normal
-        else{
-            switch(semaforo_state){
-                // Cor verde
-                case 0:
-                    // Alterna 1s on/restante do tempo off, graças ao booleano
-                    if(buzzer_green){
-                        pwm_set_gpio_level(BUZZER_A, wrap*0.05);
-                        pwm_set_gpio_level(BUZZER_B, wrap*0.05);
-                        buzzer_green=false; // Desaciona o buzzer para os segundos seguintes da luz verde
-                    }
-                    else{
-                        pwm_set_gpio_level(BUZZER_A, 0);
-                        pwm_set_gpio_level(BUZZER_B, 0);
-                    }
-                    vTaskDelay(pdMS_TO_TICKS(1000));
-                    break;
+// Altera a duração de um intervalo e grava a nova imagem de planos (versão + 1), que o
+// controlador adota no fim do ciclo. A gravação apaga um setor com os dois cores parados por
+// dezenas de ms; os prazos são absolutos, então o atraso não se acumula. Responde a nova versão.
+protocol_status_t cmd_plano_intervalo(const uint8_t *dados, uint tamanho, uint8_t *resposta, uint *tamanho_resposta){
+    if(tamanho != 6){
+        return PROTOCOL_ERR_ARGS;
+    }
+    uint plano = dados[0];
+    uint intervalo = dados[1];
+    uint32_t duracao_ms = dados[2] | dados[3] << 8 | dados[4] << 16 | (uint32_t)dados[5] << 24;
+    const plan_store_header_t *ativa = plan_store_active();
+    if(plano >= ativa->num_planos || intervalo >= plan_store_plans(ativa)[plano].num_intervalos || !duracao_ms ||
+       duracao_ms > PLAN_INTERVAL_MAX_MS){
+        return PROTOCOL_ERR_ARGS;
+    }
 
-                // Cor amarela
-                case 1:
-                    // Alterna 0,25s on/0,25s of
-                    pwm_set_gpio_level(BUZZER_A, wrap*0.05);
-                    pwm_set_gpio_level(BUZZER_B, wrap*0.05);
-                    vTaskDelay(pdMS_TO_TICKS(250));
-                    pwm_set_gpio_level(BUZZER_A, 0);
-                    pwm_set_gpio_level(BUZZER_B, 0);
-                    vTaskDelay(pdMS_TO_TICKS(250));
-                    break;
+    plan_store_header_t *img = (plan_store_header_t *)imagem_nova;
+    memcpy(img, ativa, ativa->tamanho);
+    plan_interval_t *intervalos = (plan_interval_t *)plan_store_intervals(img);
+    intervalos[plan_store_plans(img)[plano].primeiro_intervalo + intervalo].duracao_ms = duracao_ms;
+    img->versao++;
+    // Falha sobretudo quando a gravação anterior ainda não foi adotada pelo controlador
+    if(!plan_store_write(img)){
+        return PROTOCOL_ERR_BUSY;
+    }
+    LOG("(PLAN) plano %lu, intervalo %lu: %lu ms (versao %lu)\n", plano, intervalo, duracao_ms, img->versao);
+    memcpy(resposta, &img->versao, sizeof(img->versao));
+    *tamanho_resposta = sizeof(img->versao);
+    return PROTOCOL_OK;
+}
 
-                // Cor vermelha
-                case 2:
-                    // Alterna 0.5s on/1.5s off
-                    pwm_set_gpio_level(BUZZER_A, wrap*0.05);
-                    pwm_set_gpio_level(BUZZER_B, wrap*0.05);
-                    vTaskDelay(pdMS_TO_TICKS(500));
-                    pwm_set_gpio_level(BUZZER_A, 0);
-                    pwm_set_gpio_level(BUZZER_B, 0);
-                    vTaskDelay(pdMS_TO_TICKS(1500)); 
-                    break;
-            }
-        }
+// Acerta o relógio do dia, que escolhe o plano por horário
+protocol_status_t cmd_relogio(const uint8_t *dados, uint tamanho, uint8_t *resposta, uint *tamanho_resposta){
+    if(tamanho != 2){
+        return PROTOCOL_ERR_ARGS;
     }
+    uint minuto = dados[0] | dados[1] << 8;
+    if(minuto >= PLAN_STORE_MINUTES_PER_DAY){
+        return PROTOCOL_ERR_ARGS;
+    }
+    uint decorrido = (time_us_64() / 60000000u) % PLAN_STORE_MINUTES_PER_DAY;
+    relogio_inicio_min = (minuto + PLAN_STORE_MINUTES_PER_DAY - decorrido) % PLAN_STORE_MINUTES_PER_DAY;
+    return PROTOCOL_OK;
 }
 
+#ifdef SEMAFORO_TRACE
+protocol_status_t cmd_trace(const uint8_t *dados, uint tamanho, uint8_t *resposta, uint *tamanho_resposta){
+    trace_dump();
+    return PROTOCOL_OK;
+}
+#endif
+
+const protocol_command_t comandos_protocolo[] = {
+    {CMD_ESTADO, cmd_estado},
+    {CMD_CONTADORES, cmd_contadores},
+    {CMD_MODO_NOTURNO, cmd_modo_noturno},
+    {CMD_PLANO_INTERVALO, cmd_plano_intervalo},
+    {CMD_RELOGIO, cmd_relogio},
+#ifdef SEMAFORO_TRACE
+    {CMD_TRACE, cmd_trace},
+#endif
+};
+
+
 // Task para controle do Display OLED
 void vDisplayOLEDTask(){
     // Configurando a I2C
@@ -280,93 +767,65 @@ void vDisplayOLEDTask(){
     gpio_pull_up(I2C_SDA);                                        // Pull up the data line
     gpio_pull_up(I2C_SCL);                                        // Pull up the clock line
     ssd1306_t ssd;                                                // Inicializa a estrutura do display
-    ssd1306_init(&ssd, WIDTH, HEIGHT, false, endereco, I2C_PORT); // Inicializa o display
+    ssd1306_init_static(&ssd, false, endereco, I2C_PORT, &display_buffers); // Inicializa o display
     ssd1306_config(&ssd);                                         // Configura o display
     ssd1306_send_data(&ssd);                                      // Envia os dados para o display
     // Limpa o display. O display inicia com todos os pixels apagados.
     ssd1306_fill(&ssd, false);
     ssd1306_send_data(&ssd);
+    // Os próximos envios são feitos pela DMA, com aviso de término via notificação
+    ssd1306_set_flush_callback(&ssd, display_flush_done, xTaskGetCurrentTaskHandle());
+    bool flush_pending = false;
+    bool painel_noturno = false; // Modo em que o painel está configurado
+
+    // Camadas pré-renderizadas: cada estado ganha um frame completo com a moldura e seus textos fixos,
+    // desenhados só aqui no início
+    for(uint i = 0; i < NUM_TELAS; i++){
+        ssd1306_fill(&ssd, false);
+        desenha_moldura(&ssd);
+        ssd1306_draw_string(&ssd, telas[i].modo, 48, 16, false);
+        ssd1306_draw_string(&ssd, telas[i].cor, 48, 28, false);
+        ssd1306_draw_string(&ssd, telas[i].mensagem, 4, 48, false);
+        if(i == TELA_NOTURNO){
+            ssd1306_draw_string(&ssd, "!", 109, 48, false); // Tempo
+        }
+        ssd1306_layer_capture(&ssd, display_layers[i]);
+    }
 
     while(true){
-        ssd1306_fill(&ssd, false); // Limpa o display
-
-        // Frame que será reutilizado para todos
-        ssd1306_rect(&ssd, 0, 0, 128, 64, cor, !cor);
-        // Nome superior
-        ssd1306_rect(&ssd, 0, 0, 128, 12, cor, cor); // Fundo preenchido
-        ssd1306_draw_string(&ssd, "SEMAFORO", 4, 3, true); // String: Semaforo
-        ssd1306_draw_string(&ssd, "TM", 107, 3, true);
-        // Modo
-        ssd1306_draw_string(&ssd, "MODO:", 4, 16, false);
-        // Cor
-        ssd1306_draw_string(&ssd, "COR:", 4, 28, false);
-        // Borda do tempo
-        ssd1306_rect(&ssd, 48, 100, 26, 8, cor, !cor);
+        TickType_t espera = portMAX_DELAY;
 
         // Modo noturno
         if(night_mode){
-            // Modo
-            ssd1306_draw_string(&ssd, "NOTURNO", 48, 16, false);
-            // Cor
-            ssd1306_draw_string(&ssd, "AMARELO", 48, 28, false);
-            // Mensagem
-            ssd1306_draw_string(&ssd, "ATENCAO", 4, 48, false);
-            // Tempo
-            ssd1306_draw_string(&ssd, "!", 109, 48, false);
-
-            vTaskDelay(pdMS_TO_TICKS(100));
+            ssd1306_layer_apply(&ssd, display_layers[TELA_NOTURNO]);
         }
 
-        // Modo normal
+        // Modo normal: só o tempo restante é desenhado sobre a camada do estado
         else{
-            switch(semaforo_state){
-                // Luz verde
-                case 0:
-                    // Modo
-                    ssd1306_draw_string(&ssd, "NORMAL", 48, 16, false);
-                    // Cor
-                    ssd1306_draw_string(&ssd, "VERDE", 48, 28, false);
-                    // Mensagem
-                    ssd1306_draw_string(&ssd, "LIBERADO", 4, 48, false);
-                    // Tempo
-                    green_count--; 
-                    int_2_string(green_count);
-                    ssd1306_draw_string(&ssd, converted_string, 105, 48, false);
-                    break;
+            Fase fase = le_fase();
+            TickType_t restante = tempo_restante(&fase);
+            TickType_t segundo = pdMS_TO_TICKS(1000);
+            ssd1306_layer_apply(&ssd, display_layers[fase.estado]);
+            int_2_string((restante + segundo - 1) / segundo); // Segundos restantes, arredondado para cima
+            ssd1306_draw_string(&ssd, converted_string, 105, 48, false);
+            // Acorda exatamente quando o número exibido muda
+            espera = restante % segundo ? restante % segundo : segundo;
+        }
 
-                // Luz amarela
-                case 1:
-                    // Modo
-                    ssd1306_draw_string(&ssd, "NORMAL", 48, 16, false);
-                    // Cor
-                    ssd1306_draw_string(&ssd, "AMARELO", 48, 28, false);
-                    // Mensagem
-                    ssd1306_draw_string(&ssd, "ATENCAO", 4, 48, false);
-                    // Tempo
-                    yellow_count--; 
-                    int_2_string(yellow_count);
-                    ssd1306_draw_string(&ssd, converted_string, 105, 48, false);
-                    break;
+        // Aguarda o envio anterior (normalmente já concluído) antes de entregar o novo frame
+        if(flush_pending){
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+        }
+        flush_pending = ssd1306_send_data_async(&ssd); // Envia pela DMA e segue desenhando o próximo frame
 
-                // Luz vermelha
-                case 2:
-                    // Modo
-                    ssd1306_draw_string(&ssd, "NORMAL", 48, 16, false);
-                    // Cor
-                    ssd1306_draw_string(&ssd, "VERMELHA", 48, 28, false);
-                    // Mensagem
-                    ssd1306_draw_string(&ssd, "PARE!", 4, 48, false);
-                    // Tempo
-                    red_count--; 
-                    int_2_string(red_count);
-                    ssd1306_draw_string(&ssd, converted_string, 105, 48, false);
-                    // Decrementa o contador de tempo a cada 1s
-                    break;
-            }
-            vTaskDelay(1000);
+        // Só envia comandos ao painel na troca de modo (os comandos aguardam o envio acima)
+        if(night_mode != painel_noturno){
+            painel_noturno = night_mode;
+            display_modo_noturno(&ssd, painel_noturno);
         }
 
-        ssd1306_send_data(&ssd); // Envia os dados para o display, atualizando o mesmo
+        // Redesenha na próxima mudança de estado ou, no modo normal, a cada segundo da contagem
+        aguarda_evento(EVT_DISPLAY, espera);
     }
 }
 
@@ -374,17 +833,19 @@ void vDisplayOLEDTask(){
 void vLedMatrixTask(){
     // Inicializando a PIO
     pio = pio0;
-    sm = 0;
-    uint offset = pio_add_program(pio, &ws2812_program);
-    ws2812_program_init(pio, sm, offset, LED_MATRIX_PIN, 800000, IS_RGBW);
-
-    float matrix_intensity;
+    sm = pio_claim_unused_sm(pio, true);
+    led_matrix_init(pio, sm, LED_MATRIX_PIN);
 
     while(true){
         // Modo noturno
         if(night_mode){
-            matrix_intensity = 0.01*matrix_intensity_step;
-            yellow_animation(matrix_intensity);
+#ifdef SEMAFORO_LOW_POWER
+            // Pisca junto com o LED RGB (2s aceso/2s apagado): uma acordada a cada 2s em vez do pulso a 20 Hz
+            yellow_animation(matrix_blink_apagado ? 0 : MATRIX_YELLOW_MAX);
+            matrix_blink_apagado = !matrix_blink_apagado;
+            aguarda_frame_matriz(2000);
+#else
+            yellow_animation(led_pulse_scale(MATRIX_YELLOW_MAX, matrix_intensity_step*255/10));
             // Animação de pulsar o desenho na matriz de leds
             if(matrix_intensity_rising){ 
                 matrix_intensity_step++;
@@ -398,7 +859,8 @@ void vLedMatrixTask(){
                     matrix_intensity_rising=true;
                 }
             }
-            vTaskDelay(pdMS_TO_TICKS(50));
+            aguarda_frame_matriz(50);
+#endif
         }
         // Modo normal
         else{
@@ -410,13 +872,12 @@ void vLedMatrixTask(){
                     if(green_frame_index>5){ // Limita a no máximo 5 (são 6 frames)
                         green_frame_index=0;
                     }
-                    vTaskDelay(pdMS_TO_TICKS(200));
+                    aguarda_frame_matriz(200);
                     break;
     
                 // Cor amarela
                 case 1:
-                    matrix_intensity = 0.01*matrix_intensity_step;
-                    yellow_animation(matrix_intensity);
+                    yellow_animation(led_pulse_scale(MATRIX_YELLOW_MAX, matrix_intensity_step*255/10));
                     // Animação de pulsar o desenho na matriz de leds
                     if(matrix_intensity_rising){ 
                         matrix_intensity_step++;
@@ -430,13 +891,12 @@ void vLedMatrixTask(){
                             matrix_intensity_rising=true;
                         }
                     }
-                    vTaskDelay(pdMS_TO_TICKS(50));
+                    aguarda_frame_matriz(50);
                     break;
     
                 // Cor vermelha
                 case 2:
-                    matrix_intensity = 0.005*matrix_intensity_step;
-                    red_animation(matrix_intensity);
+                    red_animation(led_pulse_scale(MATRIX_RED_MAX, matrix_intensity_step*255/10));
                     // Animação de pulsar o desenho na matriz de leds
                     if(matrix_intensity_rising){ 
                         matrix_intensity_step++;
@@ -450,7 +910,7 @@ void vLedMatrixTask(){
                             matrix_intensity_rising=true;
                         }
                     }
-                    vTaskDelay(pdMS_TO_TICKS(50));
+                    aguarda_frame_matriz(50);
                     break;
             }
         }
@@ -458,15 +918,89 @@ void vLedMatrixTask(){
 }
 
 
+// MEMÓRIA ESTÁTICA DO KERNEL =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Com configSUPPORT_STATIC_ALLOCATION, as tasks idle e de timers usam estes buffers
+static StaticTask_t idle_tcb;
+static StackType_t idle_stack[configMINIMAL_STACK_SIZE];
+static StaticTask_t timer_service_tcb;
+static StackType_t timer_service_stack[configTIMER_TASK_STACK_DEPTH];
+
+void vApplicationGetIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack, configSTACK_DEPTH_TYPE *stack_words){
+    *tcb = &idle_tcb;
+    *stack = idle_stack;
+    *stack_words = configMINIMAL_STACK_SIZE;
+}
+
+#if configNUMBER_OF_CORES > 1
+// Idle dos demais cores no SMP
+static StaticTask_t passive_idle_tcb[configNUMBER_OF_CORES - 1];
+static StackType_t passive_idle_stack[configNUMBER_OF_CORES - 1][configMINIMAL_STACK_SIZE];
+
+void vApplicationGetPassiveIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack, configSTACK_DEPTH_TYPE *stack_words, BaseType_t index){
+    *tcb = &passive_idle_tcb[index];
+    *stack = passive_idle_stack[index];
+    *stack_words = configMINIMAL_STACK_SIZE;
+}
+#endif
+
+void vApplicationGetTimerTaskMemory(StaticTask_t **tcb, StackType_t **stack, configSTACK_DEPTH_TYPE *stack_words){
+    *tcb = &timer_service_tcb;
+    *stack = timer_service_stack;
+    *stack_words = configTIMER_TASK_STACK_DEPTH;
+}
+
+#if configCHECK_FOR_STACK_OVERFLOW
+// Stack estourada (conferida pelo kernel a cada troca de contexto): para tudo com o nome da task
+void vApplicationStackOverflowHook(TaskHandle_t task, char *nome){
+    panic("stack overflow na task %s", nome);
+}
+#endif
+
+
 int main(){
     stdio_init_all();
+    // Os logs são impressos por uma task própria; as demais só registram, sem esperar pelo stdio
+    log_init();
+
+    state_events = xEventGroupCreateStatic(&state_events_buffer);
+    // Planos de temporização: a cópia válida mais recente da flash, lida no lugar pelo XIP.
+    // Só o CRC e os limites das tabelas são conferidos, sem montar nada em RAM.
+    uint64_t validacao_us = time_us_64();
+    const plan_store_header_t *planos = plan_store_init(&planos_padrao.cabecalho);
+    validacao_us = time_us_64() - validacao_us;
+    LOG("(PLAN) %s: versao %lu, %lu planos, validados em %lu us\n", planos == &planos_padrao.cabecalho ? "padrao" : "flash",
+        planos->versao, planos->num_planos, (uint32_t)validacao_us);
+    button_init(BUTTON_A, &button_a_config, trata_botao_a);
 
-    xTaskCreate(vTimerSemaforoTask, "Timer Semaforo Task", configMINIMAL_STACK_SIZE, NULL, tskIDLE_PRIORITY, NULL);
-    xTaskCreate(vReadButtonTask, "Read Button Task", configMINIMAL_STACK_SIZE, NULL, tskIDLE_PRIORITY, NULL);
-    xTaskCreate(vLedsRGBSemaforoTask, "Leds Semaforo Task", configMINIMAL_STACK_SIZE, NULL, tskIDLE_PRIORITY, NULL);
-    xTaskCreate(vDisplayOLEDTask, "Display OLED Task", configMINIMAL_STACK_SIZE, NULL, tskIDLE_PRIORITY, NULL);
-    xTaskCreate(vBuzzerTask, "Buzzer Task", configMINIMAL_STACK_SIZE, NULL, tskIDLE_PRIORITY, NULL);
-    xTaskCreate(vLedMatrixTask, "Led Matrix Task", configMINIMAL_STACK_SIZE, NULL, tskIDLE_PRIORITY, NULL);
+    // Ativando o PWM do LED RGB com 0% de DC
+    set_pwm(LED_RED, wrap);
+    set_pwm(LED_GREEN, wrap);
+    set_pwm(LED_BLUE, wrap); // O azul não é usado e fica apagado
+    // Canais do sequenciador: os padrões são aplicados a cada publicação de estado
+    pattern_channel_init(&canal_led_red, (const uint[]){LED_RED}, 1, wrap);
+    pattern_channel_init(&canal_led_green, (const uint[]){LED_GREEN}, 1, wrap);
+    // Buzzers na pio1 (a pio0 fica com a matriz de leds), começando em silêncio
+    buzzer_init(pio1, (const uint[BUZZER_CHANNELS]){BUZZER_A, BUZZER_B});
+
+#ifdef SEMAFORO_LOW_POWER
+    // Relatório periódico de acordadas e corrente estimada
+    power_init(POWER_REPORT_MS);
+#endif
+
+    // As IRQs de DMA do display e da matriz são habilitadas dentro das tasks, então também ficam no core 1
+    cria_task(vTimerSemaforoTask, "Timer Semaforo Task", stack_timer_semaforo, STACK_TIMER_SEMAFORO, &tcb_timer_semaforo, CORE_CONTROLE);
+    cria_task(vDisplayOLEDTask, "Display OLED Task", stack_display, STACK_DISPLAY, &tcb_display, CORE_INTERFACE);
+    cria_task(vLedMatrixTask, "Led Matrix Task", stack_matrix, STACK_MATRIX, &tcb_matrix, CORE_INTERFACE);
+#ifdef SEMAFORO_TRACE
+    // Trace em RAM, enviado pelo stdio com o CMD_TRACE
+    trace_init();
+#endif
+    // Comandos e telemetria pelo stdio, em quadros binários
+    protocol_init(comandos_protocolo, sizeof(comandos_protocolo) / sizeof(comandos_protocolo[0]));
+#if defined(SEMAFORO_STACK_REPORT) || defined(SEMAFORO_RUNTIME_STATS)
+    // Relatório periódico de uso de CPU, trocas de contexto e pico de uso de cada stack
+    task_monitor_init(TASK_MONITOR_REPORT_MS);
+#endif
 
     vTaskStartScheduler();
     panic_unsupported();
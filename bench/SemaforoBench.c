@@ -0,0 +1,437 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "led_matrix.h"
+#include "ssd1306.h"
+#include "signal_plan.h"
+#include "plan_store.h"
+#include "log.h"
+#if PICO_ON_DEVICE
+#include "hardware/structs/systick.h"
+#else
+#include <time.h>
+#endif
+
+// Benchmark das primitivas do display e da matriz de leds e do avanço do plano semafórico. Cada operação roda
+// BENCH_ITERACOES vezes dentro de uma task, como no firmware, e o resultado sai em CSV:
+//   bench,plataforma,ops,ns_por_op,i2c_bytes_por_op,pio_palavras_por_op
+// Os bytes da I2C são as entradas entregues ao IC_DATA_CMD (comandos e dados).
+
+#define I2C_PORT i2c1
+#define I2C_SDA 14
+#define I2C_SCL 15
+#define endereco 0x3C
+#define LED_MATRIX_PIN 7
+
+#define BENCH_ITERACOES 200
+// No RP2040 a bateria se repete a cada BENCH_REPETE_MS, para ser lida a qualquer momento pelo terminal
+#define BENCH_REPETE_MS 10000
+#ifndef BENCH_STACK
+#define BENCH_STACK 1024
+#endif
+
+#if PICO_ON_DEVICE
+#define BENCH_PLATAFORMA "rp2040"
+#else
+#define BENCH_PLATAFORMA "host"
+#endif
+
+// Operação medida: prepara roda fora da medição (ex.: esperar o envio anterior terminar)
+typedef struct {
+    const char *nome;
+    void (*prepara)(uint i);
+    void (*executa)(uint i);
+} Bench;
+
+ssd1306_t ssd;
+ssd1306_buffers_t display_buffers;
+// Camada pré-renderizada da tela do sinal verde, como na vDisplayOLEDTask
+uint8_t display_layer[SSD1306_BUFFER_SIZE];
+const uint32_t bench_frame[NUM_PIXELS] = LED_FRAME(
+    LED_GRB(255, 0, 0), 0, LED_GRB(0, 255, 0), 0, LED_GRB(0, 0, 255),
+    0, LED_GRB(255, 255, 0), 0, LED_GRB(0, 255, 255), 0,
+    LED_GRB(255, 255, 255), 0, LED_GRB(255, 0, 0), 0, LED_GRB(255, 255, 255),
+    0, LED_GRB(0, 255, 255), 0, LED_GRB(255, 255, 0), 0,
+    LED_GRB(0, 0, 255), 0, LED_GRB(0, 255, 0), 0, LED_GRB(255, 0, 0)
+);
+// Plano sintético com N grupos: cada grupo tem seu verde e seu amarelo, então cada avanço
+// troca no máximo dois grupos, qualquer que seja N
+plan_interval_t bench_intervalos[2 * PLAN_MAX_GROUPS];
+plan_t bench_plano;
+plan_runner_t bench_plano_exec;
+volatile uint32_t bench_trocas = 0;
+// Imagem de planos quase cheia (um setor), como a validada no boot do firmware
+#define BENCH_PLANOS 48
+#define BENCH_PLANO_INTERVALOS 8
+uint32_t bench_imagem[PLAN_STORE_MAX_BYTES / sizeof(uint32_t)];
+StackType_t bench_stack[BENCH_STACK];
+StaticTask_t bench_tcb;
+
+
+// RELÓGIO =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+#if PICO_ON_DEVICE
+// O M0+ não tem contador de ciclos: o tick da FreeRTOS conta os ms e o contador regressivo do
+// SysTick (um ciclo do seu clock) dá a fração do tick atual. Só vale no core do tick.
+uint64_t bench_agora_ns(){
+    TickType_t tick;
+    uint32_t cvr;
+    do{
+        tick = xTaskGetTickCount();
+        cvr = systick_hw->cvr;
+    } while(tick != xTaskGetTickCount()); // Um tick no meio da leitura
+    uint32_t rvr = systick_hw->rvr;
+    uint64_t ns_tick = 1000000000u / configTICK_RATE_HZ;
+    return (uint64_t)tick * ns_tick + (uint64_t)(rvr - cvr) * ns_tick / (rvr + 1);
+}
+#else
+uint64_t bench_agora_ns(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000u + t.tv_nsec;
+}
+#endif
+
+
+// OPERAÇÕES =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+// Mesmos elementos fixos da desenha_moldura do firmware
+void desenha_moldura(ssd1306_t *ssd){
+    ssd1306_rect(ssd, 0, 0, 128, 64, true, false);
+    ssd1306_rect(ssd, 0, 0, 128, 12, true, true);
+    ssd1306_draw_string(ssd, "SEMAFORO", 4, 3, true);
+    ssd1306_draw_string(ssd, "TM", 107, 3, true);
+    ssd1306_draw_string(ssd, "MODO:", 4, 16, false);
+    ssd1306_draw_string(ssd, "COR:", 4, 28, false);
+    ssd1306_rect(ssd, 48, 100, 26, 8, true, false);
+}
+
+// Segundos restantes da fase no formato do display (2 dígitos), variando a cada iteração
+void segundos(uint i, char *texto){
+    uint s = 15 - i % 15;
+    texto[0] = '0' + s / 10;
+    texto[1] = '0' + s % 10;
+    texto[2] = '\0';
+}
+
+void nada(uint i){}
+
+// Espera o envio anterior, fora da medição
+void espera_display(uint i){
+    ssd1306_wait(&ssd);
+}
+
+void espera_matriz(uint i){
+    while(led_matrix_busy()){
+        tight_loop_contents();
+    }
+}
+
+// Frame inteiro diferente do último enviado, para medir o envio completo
+void prepara_frame(uint i){
+    ssd1306_wait(&ssd);
+    ssd1306_fill(&ssd, i & 1);
+}
+
+void fill(uint i){
+    ssd1306_fill(&ssd, i & 1);
+}
+
+void rect(uint i){
+    ssd1306_rect(&ssd, 0, 0, 128, 64, true, false);
+}
+
+void rect_cheio(uint i){
+    ssd1306_rect(&ssd, 0, 0, 128, 12, i & 1, true);
+}
+
+void draw_string(uint i){
+    ssd1306_draw_string(&ssd, "SEMAFORO", 4, 3, i & 1);
+}
+
+// Mesma string pela referência pixel a pixel, para comparar com a linha acima
+void draw_string_ref(uint i){
+    const char *str = "SEMAFORO";
+    for(uint8_t x = 4; *str; x += 8){
+        ssd1306_draw_char_ref(&ssd, *str++, x, 3, i & 1);
+    }
+}
+
+void line(uint i){
+    ssd1306_line(&ssd, 0, 0, 127, 63, i & 1);
+}
+
+void send_data_async(uint i){
+    ssd1306_send_data_async(&ssd);
+}
+
+// Frame do modo normal da vDisplayOLEDTask: camada do estado, tempo restante e envio pela DMA
+void painel_camadas(uint i){
+    char texto[3];
+    segundos(i, texto);
+    ssd1306_layer_apply(&ssd, display_layer);
+    ssd1306_draw_string(&ssd, texto, 105, 48, false);
+    ssd1306_send_data_async(&ssd);
+}
+
+// O mesmo frame redesenhado do zero, sem as camadas pré-renderizadas
+void painel_completo(uint i){
+    char texto[3];
+    segundos(i, texto);
+    ssd1306_fill(&ssd, false);
+    desenha_moldura(&ssd);
+    ssd1306_draw_string(&ssd, "NORMAL", 48, 16, false);
+    ssd1306_draw_string(&ssd, "VERDE", 48, 28, false);
+    ssd1306_draw_string(&ssd, "LIBERADO", 4, 48, false);
+    ssd1306_draw_string(&ssd, texto, 105, 48, false);
+    ssd1306_send_data_async(&ssd);
+}
+
+void set_leds_frame(uint i){
+    set_leds(bench_frame, LED_SCALE(0.10));
+}
+
+// Escala de um frame sem a DMA: o caminho antigo do set_leds (float por canal, convertido por
+// um urgb_u32 com double) contra o atual em ponto fixo Q16
+uint32_t bench_escalado[NUM_PIXELS];
+
+static uint32_t urgb_u32_float(double r, double g, double b){
+    return ((uint32_t)(g) << 24) | ((uint32_t)(r) << 16) | ((uint32_t)(b) << 8);
+}
+
+void escala_frame_float(uint i){
+    float intensidade = 0.10f;
+    for(int p = 0; p < NUM_PIXELS; p++){
+        uint32_t word = bench_frame[p];
+        bench_escalado[p] = urgb_u32_float(intensidade * ((word >> 16) & 0xFF), intensidade * (word >> 24),
+                                           intensidade * ((word >> 8) & 0xFF));
+    }
+}
+
+void escala_frame_q16(uint i){
+    uint32_t escala = LED_SCALE(0.10);
+    for(int p = 0; p < NUM_PIXELS; p++){
+        uint32_t word = bench_frame[p];
+        bench_escalado[p] = (((((word >> 24) & 0xFF) * escala) >> 16) << 24) |
+                            (((((word >> 16) & 0xFF) * escala) >> 16) << 16) |
+                            (((((word >> 8) & 0xFF) * escala) >> 16) << 8);
+    }
+}
+
+void green_animation_frame(uint i){
+    green_animation(i);
+}
+
+void yellow_animation_pulso(uint i){
+    yellow_animation(led_pulse_scale(LED_SCALE(0.10), i * 255 / BENCH_ITERACOES));
+}
+
+void conta_troca(const plan_runner_t *r, uint grupo, signal_state_t estado){
+    bench_trocas++;
+}
+
+void monta_plano(uint grupos){
+    if(bench_plano.num_grupos == grupos){
+        return;
+    }
+    for(uint g = 0; g < grupos; g++){
+        bench_intervalos[2 * g] = (plan_interval_t){PLAN_GROUP(g, SIGNAL_GREEN), 1000};
+        bench_intervalos[2 * g + 1] = (plan_interval_t){PLAN_GROUP(g, SIGNAL_YELLOW), 1000};
+    }
+    bench_plano = (plan_t){bench_intervalos, 2 * grupos, grupos};
+    plan_start(&bench_plano_exec, &bench_plano, 0, conta_troca);
+}
+
+void prepara_plano_2(uint i){ monta_plano(2); }
+void prepara_plano_4(uint i){ monta_plano(4); }
+void prepara_plano_8(uint i){ monta_plano(8); }
+void prepara_plano_16(uint i){ monta_plano(16); }
+
+void monta_imagem(uint i){
+    plan_store_header_t *img = (plan_store_header_t *)bench_imagem;
+    if(img->magic == PLAN_STORE_MAGIC){
+        return;
+    }
+    *img = (plan_store_header_t){
+        .magic = PLAN_STORE_MAGIC, .formato = PLAN_STORE_FORMAT, .num_planos = BENCH_PLANOS,
+        .num_intervalos = BENCH_PLANOS * BENCH_PLANO_INTERVALOS, .num_horarios = BENCH_PLANOS,
+    };
+    img->tamanho = sizeof(plan_store_header_t) + BENCH_PLANOS * (sizeof(plan_store_plan_t) +
+                   BENCH_PLANO_INTERVALOS * sizeof(plan_interval_t) + sizeof(plan_store_schedule_t));
+    plan_store_plan_t *planos = (plan_store_plan_t *)plan_store_plans(img);
+    plan_interval_t *intervalos = (plan_interval_t *)plan_store_intervals(img);
+    plan_store_schedule_t *horarios = (plan_store_schedule_t *)plan_store_schedule(img);
+    for(uint p = 0; p < BENCH_PLANOS; p++){
+        planos[p] = (plan_store_plan_t){p * BENCH_PLANO_INTERVALOS, BENCH_PLANO_INTERVALOS, 3};
+        for(uint n = 0; n < BENCH_PLANO_INTERVALOS; n++){
+            intervalos[p * BENCH_PLANO_INTERVALOS + n] = (plan_interval_t){PLAN_GROUP(n % 3, SIGNAL_GREEN), 1000 + p};
+        }
+        horarios[p] = (plan_store_schedule_t){p * 30, p};
+    }
+    img->crc = plan_store_crc32(&img->magic, img->tamanho - sizeof(img->crc));
+}
+
+// Validação de uma cópia no boot (CRC e limites): a escolha do plano é só uma busca na tabela de horários
+void plan_store_valida(uint i){
+    if(!plan_store_valid((const plan_store_header_t *)bench_imagem, true)){
+        panic_unsupported();
+    }
+}
+
+// Esvazia os anéis do log, como a task do log faria, para que cada registro encontre espaço
+void esvazia_log(uint i){
+    log_record_t r;
+    while(log_read(&r));
+}
+
+// Um registro de log no caminho quente. Sem a task do log, vai para o anel do core (o das ISRs,
+// com as interrupções bloqueadas durante a cópia); o de uma task só troca isso pela busca no TLS.
+void log_linha(uint i){
+    LOG("(BENCH) iteracao %lu de %lu\n", i, BENCH_ITERACOES);
+}
+
+// Uma transição do controlador: o resto do tempo ele fica bloqueado até o próximo prazo
+void plan_advance_intervalo(uint i){
+    plan_advance(&bench_plano_exec);
+}
+
+const Bench benchs[] = {
+    {"ssd1306_fill", nada, fill},
+    {"ssd1306_rect", nada, rect},
+    {"ssd1306_rect_cheio", nada, rect_cheio},
+    {"ssd1306_draw_string", nada, draw_string},
+    {"ssd1306_draw_string_ref", nada, draw_string_ref},
+    {"ssd1306_line", nada, line},
+    {"ssd1306_send_data_async_frame", prepara_frame, send_data_async},
+    {"painel_camadas", espera_display, painel_camadas},
+    {"painel_completo", espera_display, painel_completo},
+    {"set_leds", espera_matriz, set_leds_frame},
+    {"escala_frame_float", nada, escala_frame_float},
+    {"escala_frame_q16", nada, escala_frame_q16},
+    {"green_animation", espera_matriz, green_animation_frame},
+    {"yellow_animation", espera_matriz, yellow_animation_pulso},
+    {"plan_advance_2_grupos", prepara_plano_2, plan_advance_intervalo},
+    {"plan_advance_4_grupos", prepara_plano_4, plan_advance_intervalo},
+    {"plan_advance_8_grupos", prepara_plano_8, plan_advance_intervalo},
+    {"plan_advance_16_grupos", prepara_plano_16, plan_advance_intervalo},
+    {"plan_store_valid_48_planos", monta_imagem, plan_store_valida},
+    {"log_write", esvazia_log, log_linha},
+};
+
+
+// EXECUÇÃO =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+void roda_bench(const Bench *b){
+    uint64_t total_ns = 0;
+    b->prepara(0);
+    b->executa(0); // Aquecimento (cache do XIP)
+
+    uint32_t bytes_inicio = ssd.bytes_sent;
+    uint32_t palavras_inicio = led_matrix_words_sent();
+    for(uint i = 1; i <= BENCH_ITERACOES; i++){
+        b->prepara(i);
+        uint64_t inicio = bench_agora_ns();
+        b->executa(i);
+        total_ns += bench_agora_ns() - inicio;
+    }
+    uint32_t bytes = ssd.bytes_sent - bytes_inicio;
+    uint32_t palavras = led_matrix_words_sent() - palavras_inicio;
+
+    printf("%s,%s,%u,%lu,%lu,%lu\n", b->nome, BENCH_PLATAFORMA, BENCH_ITERACOES,
+           (unsigned long)(total_ns / BENCH_ITERACOES), (unsigned long)(bytes / BENCH_ITERACOES),
+           (unsigned long)(palavras / BENCH_ITERACOES));
+}
+
+void vBenchTask(){
+    // Display e matriz configurados como nas tasks do firmware
+    i2c_init(I2C_PORT, 400 * 1000);
+    gpio_set_function(I2C_SDA, GPIO_FUNC_I2C);
+    gpio_set_function(I2C_SCL, GPIO_FUNC_I2C);
+    gpio_pull_up(I2C_SDA);
+    gpio_pull_up(I2C_SCL);
+    ssd1306_init_static(&ssd, false, endereco, I2C_PORT, &display_buffers);
+    ssd1306_config(&ssd);
+    ssd1306_send_data(&ssd);
+
+    ssd1306_fill(&ssd, false);
+    desenha_moldura(&ssd);
+    ssd1306_draw_string(&ssd, "NORMAL", 48, 16, false);
+    ssd1306_draw_string(&ssd, "VERDE", 48, 28, false);
+    ssd1306_draw_string(&ssd, "LIBERADO", 4, 48, false);
+    ssd1306_layer_capture(&ssd, display_layer);
+
+    led_matrix_init(pio0, pio_claim_unused_sm(pio0, true), LED_MATRIX_PIN);
+
+    while(true){
+        printf("bench,plataforma,ops,ns_por_op,i2c_bytes_por_op,pio_palavras_por_op\n");
+        for(uint i = 0; i < sizeof(benchs) / sizeof(benchs[0]); i++){
+            roda_bench(&benchs[i]);
+        }
+#if PICO_ON_DEVICE
+        vTaskDelay(pdMS_TO_TICKS(BENCH_REPETE_MS));
+#else
+        exit(0);
+#endif
+    }
+}
+
+
+// MEMÓRIA DAS TASKS DO KERNEL =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+static StaticTask_t idle_tcb;
+static StackType_t idle_stack[configMINIMAL_STACK_SIZE];
+static StaticTask_t timer_service_tcb;
+static StackType_t timer_service_stack[configTIMER_TASK_STACK_DEPTH];
+
+void vApplicationGetIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack, configSTACK_DEPTH_TYPE *stack_words){
+    *tcb = &idle_tcb;
+    *stack = idle_stack;
+    *stack_words = configMINIMAL_STACK_SIZE;
+}
+
+#if configNUMBER_OF_CORES > 1
+static StaticTask_t passive_idle_tcb[configNUMBER_OF_CORES - 1];
+static StackType_t passive_idle_stack[configNUMBER_OF_CORES - 1][configMINIMAL_STACK_SIZE];
+
+void vApplicationGetPassiveIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack, configSTACK_DEPTH_TYPE *stack_words, BaseType_t index){
+    *tcb = &passive_idle_tcb[index];
+    *stack = passive_idle_stack[index];
+    *stack_words = configMINIMAL_STACK_SIZE;
+}
+#endif
+
+void vApplicationGetTimerTaskMemory(StaticTask_t **tcb, StackType_t **stack, configSTACK_DEPTH_TYPE *stack_words){
+    *tcb = &timer_service_tcb;
+    *stack = timer_service_stack;
+    *stack_words = configTIMER_TASK_STACK_DEPTH;
+}
+
+#if configCHECK_FOR_STACK_OVERFLOW
+// Stack estourada (conferida pelo kernel a cada troca de contexto): para tudo com o nome da task
+void vApplicationStackOverflowHook(TaskHandle_t task, char *nome){
+    panic("stack overflow na task %s", nome);
+}
+#endif
+
+#ifdef SEMAFORO_LATENCY_STATS
+// O FreeRTOSConfig.h liga o tick hook nesse build; o benchmark não mede transições de fase
+void vApplicationTickHook(void){}
+#endif
+
+
+int main(){
+#if !PICO_ON_DEVICE
+    // No simulador as saídas só são contadas, sem o log (que pesaria na medição)
+    setenv("SIM_LOG", "", 0);
+#endif
+    stdio_init_all();
+
+    // No core do tick, onde o relógio do SysTick é válido; as IRQs de DMA também ficam nele
+#if configUSE_CORE_AFFINITY
+    xTaskCreateStaticAffinitySet(vBenchTask, "Bench", BENCH_STACK, NULL, tskIDLE_PRIORITY + 1, bench_stack, &bench_tcb, 1 << configTICK_CORE);
+#else
+    xTaskCreateStatic(vBenchTask, "Bench", BENCH_STACK, NULL, tskIDLE_PRIORITY + 1, bench_stack, &bench_tcb);
+#endif
+
+    vTaskStartScheduler();
+    panic_unsupported();
+}
@@ -42,9 +42,24 @@
  
  /* Scheduler Related */
  #define configUSE_PREEMPTION                    1
+ #ifdef SEMAFORO_LOW_POWER
+ /* Baixo consumo: o core dorme em WFI entre eventos, sem acordar a cada tick */
+ #define configUSE_TICKLESS_IDLE                 1
+ #define configEXPECTED_IDLE_TIME_BEFORE_SLEEP   2
+ /* SysTick pela referência de 1 MHz: permite suprimir até ~16 s de ticks de uma vez */
+ #define configSYSTICK_CLOCK_HZ                  1000000
+ #define configPRE_SLEEP_PROCESSING(x)           power_pre_sleep(x)
+ #define configPOST_SLEEP_PROCESSING(x)          power_post_sleep(x)
+ #else
  #define configUSE_TICKLESS_IDLE                 0
+ #endif
  #define configUSE_IDLE_HOOK                     0
+ #ifdef SEMAFORO_LATENCY_STATS
+ /* Marca o tick do prazo do controlador (vApplicationTickHook em SemaforoMultithread.c) */
+ #define configUSE_TICK_HOOK                     1
+ #else
  #define configUSE_TICK_HOOK                     0
+ #endif
  #define configTICK_RATE_HZ                      ( ( TickType_t ) 1000 )
  #define configMAX_PRIORITIES                    32
  #define configMINIMAL_STACK_SIZE                ( configSTACK_DEPTH_TYPE ) 256
@@ -69,18 +84,36 @@
  #define configMESSAGE_BUFFER_LENGTH_TYPE        size_t
  
  /* Memory allocation related definitions. */
- #define configSUPPORT_STATIC_ALLOCATION         0
+ /* Todos os objetos do kernel e da aplicação são estáticos; o build SEMAFORO_STATIC_ALLOC
+  * também remove o heap, e qualquer alocação dinâmica passa a falhar na ligação */
+ #define configSUPPORT_STATIC_ALLOCATION         1
+ #ifdef SEMAFORO_STATIC_ALLOC
+ #define configSUPPORT_DYNAMIC_ALLOCATION        0
+ #else
  #define configSUPPORT_DYNAMIC_ALLOCATION        1
+ #endif
  #define configTOTAL_HEAP_SIZE                   (128*1024)
  #define configAPPLICATION_ALLOCATED_HEAP        0
  
  /* Hook function related definitions. */
- #define configCHECK_FOR_STACK_OVERFLOW          0
+ /* As stacks estáticas das tasks ainda não foram medidas (SemaforoMultithread.c) e falham alto: a cada
+  * troca de contexto o kernel confere o fim da stack e chama vApplicationStackOverflowHook (panic com o
+  * nome da task) */
+ #define configCHECK_FOR_STACK_OVERFLOW          2
  #define configUSE_MALLOC_FAILED_HOOK            0
  #define configUSE_DAEMON_TASK_STARTUP_HOOK      0
  
  /* Run time and task stats gathering related definitions. */
+ #ifdef SEMAFORO_RUNTIME_STATS
+ /* Tempo de execução pelo timer de 64 bits em us do RP2040 (não precisa de configuração) */
+ #include "hardware/timer.h"
+ #define configGENERATE_RUN_TIME_STATS           1
+ #define configRUN_TIME_COUNTER_TYPE             uint64_t
+ #define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+ #define portGET_RUN_TIME_COUNTER_VALUE()        time_us_64()
+ #else
  #define configGENERATE_RUN_TIME_STATS           0
+ #endif
  #define configUSE_TRACE_FACILITY                1
  #define configUSE_STATS_FORMATTING_FUNCTIONS    0
  
@@ -91,7 +124,7 @@
  /* Software timer related definitions. */
  #define configUSE_TIMERS                        1
  #define configTIMER_TASK_PRIORITY               ( configMAX_PRIORITIES - 1 )
- #define configTIMER_QUEUE_LENGTH                10
+ #define configTIMER_QUEUE_LENGTH                16
  #define configTIMER_TASK_STACK_DEPTH            1024
  
  /* Interrupt nesting behaviour configuration. */
@@ -102,9 +135,19 @@
  */
  
  /* SMP port only */
- #define configNUM_CORES                         1
- #define configTICK_CORE                         1
+ #ifdef SEMAFORO_LOW_POWER
+ /* O tickless idle só é suportado com um core */
+ #define configNUMBER_OF_CORES                   1
+ #define configUSE_CORE_AFFINITY                 0
+ #else
+ #define configNUMBER_OF_CORES                   2
+ #define configUSE_CORE_AFFINITY                 1
+ /* Timers (sequenciador de padrões, botão) rodam no core 0, junto com o controle do semáforo */
+ #define configTIMER_SERVICE_TASK_CORE_AFFINITY  ( 1 << 0 )
+ #endif
+ #define configTICK_CORE                         0
  #define configRUN_MULTIPLE_PRIORITIES           1
+ #define configUSE_PASSIVE_IDLE_HOOK             0
  
  /* RP2040 specific */
  #define configSUPPORT_PICO_SYNC_INTEROP         1
@@ -134,5 +177,28 @@
  #define INCLUDE_xQueueGetMutexHolder            1
  
  /* A header file that defines trace macro can be included here. */
+
+ #ifdef SEMAFORO_RUNTIME_STATS
+ /* Contagem de trocas de contexto por task (ver task_monitor.c) */
+ void task_monitor_switched_in(void);
+ #define TRACE_HOOK_STATS()                      task_monitor_switched_in()
+ #else
+ #define TRACE_HOOK_STATS()
+ #endif
+ #ifdef SEMAFORO_TRACE
+ /* Registro das trocas de contexto no trace em RAM (ver trace.c) */
+ void trace_task_switched_in(void);
+ #define TRACE_HOOK_TRACE()                      trace_task_switched_in()
+ #else
+ #define TRACE_HOOK_TRACE()
+ #endif
+ #define traceTASK_SWITCHED_IN()                 do { TRACE_HOOK_STATS(); TRACE_HOOK_TRACE(); } while(0)
+
+ #ifdef SEMAFORO_LOW_POWER
+ /* Ganchos do tickless idle, definidos em power.c (TickType_t é de 32 bits nesta porta) */
+ #include <stdint.h>
+ void power_pre_sleep(uint32_t ticks);
+ void power_post_sleep(uint32_t ticks);
+ #endif
  
  #endif /* FREERTOS_CONFIG_H */
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "button.h"
+#include "FreeRTOS.h"
+#include "timers.h"
+#include "trace.h"
+
+// Estado do botão (um único botão por aplicação)
+static uint button_gpio;
+static button_config_t button_config;
+static button_callback_t button_callback;
+static bool stable_pressed = false; // Último nível confirmado pelo debounce
+static bool press_pending = false;  // Toque simples aguardando o fim da janela de toque duplo
+static bool long_press_fired = false; // O toque em andamento já virou toque longo
+
+// One-shots da FreeRTOS: debounce, toque longo e janela do toque duplo
+static TimerHandle_t debounce_timer;
+static TimerHandle_t long_press_timer;
+static TimerHandle_t double_press_timer;
+static StaticTimer_t debounce_timer_buffer;
+static StaticTimer_t long_press_timer_buffer;
+static StaticTimer_t double_press_timer_buffer;
+
+// Cada borda (incluindo as de bounce) reinicia o debounce: ele só expira com o nível estável
+static void button_gpio_irq(uint gpio, uint32_t events){
+    if(gpio != button_gpio){
+        return;
+    }
+    trace_log(TRACE_BOTAO_BORDA, gpio_get(gpio));
+    BaseType_t higher_priority_woken = pdFALSE;
+    xTimerResetFromISR(debounce_timer, &higher_priority_woken);
+    portYIELD_FROM_ISR(higher_priority_woken);
+}
+
+// Toque simples reconhecido: na borda de descida ou, com o toque longo ativo, na soltura
+static void button_short_press(void){
+    if(!button_config.double_press_ms){
+        button_callback(BUTTON_EVT_PRESS);
+    }
+    else if(press_pending){
+        press_pending = false;
+        xTimerStop(double_press_timer, 0);
+        button_callback(BUTTON_EVT_DOUBLE_PRESS);
+    }
+    else{
+        press_pending = true;
+        xTimerReset(double_press_timer, 0);
+    }
+}
+
+static void debounce_expired(TimerHandle_t timer){
+    bool pressed = !gpio_get(button_gpio); // Ativo em nível baixo
+    if(pressed == stable_pressed){
+        return; // Bounce que voltou ao nível anterior
+    }
+    stable_pressed = pressed;
+
+    if(!button_config.long_press_ms){
+        if(pressed){
+            button_short_press();
+        }
+        return;
+    }
+    // Com o toque longo ativo, só a soltura antes de long_press_ms decide que o toque foi simples:
+    // um toque longo nunca gera também um BUTTON_EVT_PRESS
+    if(pressed){
+        long_press_fired = false;
+        xTimerReset(long_press_timer, 0);
+    }
+    else{
+        xTimerStop(long_press_timer, 0);
+        if(!long_press_fired){
+            button_short_press();
+        }
+    }
+}
+
+static void long_press_expired(TimerHandle_t timer){
+    if(stable_pressed){
+        long_press_fired = true;
+        press_pending = false; // Um toque simples anterior, na janela do toque duplo, é descartado
+        if(button_config.double_press_ms){
+            xTimerStop(double_press_timer, 0);
+        }
+        button_callback(BUTTON_EVT_LONG_PRESS);
+    }
+}
+
+static void double_press_expired(TimerHandle_t timer){
+    if(press_pending){
+        press_pending = false;
+        button_callback(BUTTON_EVT_PRESS);
+    }
+}
+
+void button_init(uint gpio, const button_config_t *config, button_callback_t callback){
+    button_gpio = gpio;
+    button_config = *config;
+    button_callback = callback;
+
+    gpio_init(gpio);
+    gpio_set_dir(gpio, GPIO_IN);
+    gpio_pull_up(gpio);
+
+    debounce_timer = xTimerCreateStatic("Button Debounce", pdMS_TO_TICKS(config->debounce_ms), pdFALSE, NULL, debounce_expired, &debounce_timer_buffer);
+    if(config->long_press_ms){
+        long_press_timer = xTimerCreateStatic("Button Long", pdMS_TO_TICKS(config->long_press_ms), pdFALSE, NULL, long_press_expired, &long_press_timer_buffer);
+    }
+    if(config->double_press_ms){
+        double_press_timer = xTimerCreateStatic("Button Double", pdMS_TO_TICKS(config->double_press_ms), pdFALSE, NULL, double_press_expired, &double_press_timer_buffer);
+    }
+
+    gpio_set_irq_enabled_with_callback(gpio, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true, button_gpio_irq);
+}
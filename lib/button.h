@@ -0,0 +1,32 @@
+#ifndef BUTTON_H
+#define BUTTON_H
+
+#include "pico/stdlib.h"
+
+// Valores padrão dos tempos do botão (em ms)
+#define BUTTON_DEBOUNCE_MS 30
+#define BUTTON_LONG_PRESS_MS 1500
+#define BUTTON_DOUBLE_PRESS_MS 300
+
+// Eventos gerados pelo botão
+typedef enum {
+    BUTTON_EVT_PRESS,        // Toque simples: na soltura se o toque longo estiver ativo (antes de long_press_ms),
+                             // senão logo após o debounce. Com o toque duplo, só ao fim da janela.
+    BUTTON_EVT_LONG_PRESS,   // Botão mantido pressionado por long_press_ms
+    BUTTON_EVT_DOUBLE_PRESS  // Segundo toque dentro de double_press_ms
+} button_event_t;
+
+// Configuração dos tempos. Um tempo 0 desativa a detecção correspondente (exceto o debounce).
+typedef struct {
+    uint32_t debounce_ms;     // Tempo que o nível precisa ficar estável após a última borda
+    uint32_t long_press_ms;
+    uint32_t double_press_ms; // Se ativo, o toque simples só é confirmado ao fim da janela
+} button_config_t;
+
+// Callback dos eventos, executado no contexto da task de timers do FreeRTOS
+typedef void (*button_callback_t)(button_event_t evento);
+
+// Configura o botão (ativo em nível baixo, com pull-up) com interrupção nas duas bordas
+void button_init(uint gpio, const button_config_t *config, button_callback_t callback);
+
+#endif
@@ -0,0 +1,60 @@
+#include "buzzer.h"
+#include "hardware/dma.h"
+#include "buzzer_tone.pio.h"
+
+static PIO buzzer_pio;
+static uint buzzer_offset;
+static uint buzzer_sm[BUZZER_CHANNELS];
+static uint buzzer_pin[BUZZER_CHANNELS];
+static int buzzer_dma_chan[BUZZER_CHANNELS];
+// Cópia em RAM do descritor de cada canal, lida em anel pela DMA. Os tons costumam ser const (na
+// flash), e a DMA não pode ler pelo XIP enquanto o plan_store apaga ou grava um setor.
+static buzzer_tone_t buzzer_ram[BUZZER_CHANNELS];
+
+void buzzer_init(PIO pio, const uint gpios[BUZZER_CHANNELS]){
+    buzzer_pio = pio;
+    buzzer_offset = pio_add_program(pio, &buzzer_tone_program);
+
+    for(uint i = 0; i < BUZZER_CHANNELS; i++){
+        buzzer_pin[i] = gpios[i];
+        buzzer_sm[i] = pio_claim_unused_sm(pio, true);
+        buzzer_tone_program_init(pio, buzzer_sm[i], buzzer_offset, gpios[i]);
+
+        // A DMA relê o mesmo descritor de 16 bytes em anel, pacing pela FIFO da PIO
+        buzzer_dma_chan[i] = dma_claim_unused_channel(true);
+        dma_channel_config c = dma_channel_get_default_config(buzzer_dma_chan[i]);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+        channel_config_set_read_increment(&c, true);
+        channel_config_set_write_increment(&c, false);
+        channel_config_set_ring(&c, false, 4); // 2^4 = 16 bytes
+        channel_config_set_dreq(&c, pio_get_dreq(pio, buzzer_sm[i], true));
+        dma_channel_configure(buzzer_dma_chan[i], &c, &pio->txf[buzzer_sm[i]], NULL, 0, false);
+    }
+}
+
+void buzzer_play(const buzzer_tone_t *tons[BUZZER_CHANNELS]){
+    uint32_t mask = 0;
+
+    for(uint i = 0; i < BUZZER_CHANNELS; i++){
+        uint sm = buzzer_sm[i];
+        // Para o canal e descarta o que já estava na FIFO
+        pio_sm_set_enabled(buzzer_pio, sm, false);
+        dma_channel_abort(buzzer_dma_chan[i]);
+        pio_sm_clear_fifos(buzzer_pio, sm);
+        pio_sm_restart(buzzer_pio, sm);
+        pio_sm_exec(buzzer_pio, sm, pio_encode_jmp(buzzer_offset));
+        pio_sm_set_pins_with_mask(buzzer_pio, sm, 0, 1u << buzzer_pin[i]);
+
+        if(tons[i]){
+            // Com a DMA já parada, o descritor vai para a RAM. Contagem máxima: o anel o repete
+            // indefinidamente; um tom sem cadência é entregue uma vez e a PIO para no pull seguinte.
+            buzzer_ram[i] = *tons[i];
+            uint32_t palavras = sizeof(buzzer_tone_t) / sizeof(uint32_t);
+            dma_channel_set_read_addr(buzzer_dma_chan[i], &buzzer_ram[i], false);
+            dma_channel_set_trans_count(buzzer_dma_chan[i], buzzer_ram[i].silencio == BUZZER_ONCE ? palavras : 0xFFFFFFFF, true);
+            mask |= 1u << sm;
+        }
+    }
+    // Os canais ativos partem no mesmo ciclo
+    pio_enable_sm_mask_in_sync(buzzer_pio, mask);
+}
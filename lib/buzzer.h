@@ -0,0 +1,43 @@
+#ifndef BUZZER_H
+#define BUZZER_H
+
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+
+// Canais de tom (uma máquina de estados por buzzer)
+#define BUZZER_CHANNELS 2
+
+// Descritor de um segmento de tom, já no formato lido pela PIO (ver buzzer_tone.pio).
+// O alinhamento de 16 bytes permite que a DMA repita o descritor em modo anel.
+typedef struct __attribute__((aligned(16))) {
+    uint32_t alto;
+    uint32_t periodos;
+    uint32_t baixo;
+    uint32_t silencio;
+} buzzer_tone_t;
+
+#define BUZZER_PERIOD_US(freq_hz) (1000000u / (freq_hz))
+#define BUZZER_HIGH_US(freq_hz, duty) (BUZZER_PERIOD_US(freq_hz) * (duty) / 100)
+
+// Silêncio de um tom tocado uma só vez: a DMA entrega o descritor uma vez e a máquina de estados
+// fica parada no pull, com o pino em nível baixo, até a próxima troca (sem limite de tempo)
+#define BUZZER_ONCE 0
+
+// Monta um descritor: tom de freq_hz com duty (%) por on_ms, seguido de off_ms de silêncio.
+// off_ms = 0 toca o tom uma vez e mantém o silêncio até a próxima troca. Com off_ms, a cadência
+// se repete; on_ms e off_ms vão até 4294967 (~71 min, contagem de 32 bits em us).
+#define BUZZER_TONE(freq_hz, duty, on_ms, off_ms) { \
+    .alto = BUZZER_HIGH_US(freq_hz, duty) - 3, \
+    .periodos = (on_ms) * 1000u / BUZZER_PERIOD_US(freq_hz) - 1, \
+    .baixo = BUZZER_PERIOD_US(freq_hz) - BUZZER_HIGH_US(freq_hz, duty) - 4, \
+    .silencio = (off_ms) ? (off_ms) * 1000u - 8 : BUZZER_ONCE \
+}
+
+// Configura as máquinas de estados e as DMAs dos buzzers (começam em silêncio)
+void buzzer_init(PIO pio, const uint gpios[BUZZER_CHANNELS]);
+// Troca o tom de todos os canais de uma vez, com as bordas sincronizadas entre eles.
+// NULL deixa o canal em silêncio. Depois disso a cadência roda só na PIO/DMA, sem CPU.
+// Os tons são copiados: podem estar na flash e não precisam continuar válidos após a chamada.
+void buzzer_play(const buzzer_tone_t *tons[BUZZER_CHANNELS]);
+
+#endif
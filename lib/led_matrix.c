@@ -1,174 +1,226 @@
 #include "led_matrix.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "trace.h"
 
 #define MATRIX_PIN 7
 // Quantidade de pixels
 #define NUM_PIXELS 25
 
-// Buffer que armazena o frame atual, incluindo cores
-Led_frame led_buffer= {{
-    {0,0,0}, {0,0,0}, {0,0,0}, {0,0,0}, {0,0,0}, 
-    {0,0,0}, {0,0,0}, {0,0,0}, {0,0,0}, {0,0,0}, 
-    {0,0,0}, {0,0,0}, {0,0,0}, {0,0,0}, {0,0,0}, 
-    {0,0,0}, {0,0,0}, {0,0,0}, {0,0,0}, {0,0,0}, 
-    {0,0,0}, {0,0,0}, {0,0,0}, {0,0,0}, {0,0,0}, 
-}};
+// Cores já no formato de saída da PIO (GRB alinhado à esquerda)
+#define APAG LED_GRB(0, 0, 0)
+#define VERD LED_GRB(0, 255, 0)
+#define AMAR LED_GRB(255, 255, 0)
+#define VERM LED_GRB(255, 0, 0)
+#define BRAN LED_GRB(255, 255, 255)
+
+// Curva de gama 2.2: converte um nível de brilho percebido (0-255) em nível linear.
+// Gerada por round(255 * (i / 255)^2.2).
+static const uint8_t led_gamma8[256] = {
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,
+      1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+      3,   3,   3,   3,   3,   4,   4,   4,   4,   5,   5,   5,   5,   6,   6,   6,
+      6,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,  10,  11,  11,  11,  12,
+     12,  13,  13,  13,  14,  14,  15,  15,  16,  16,  17,  17,  18,  18,  19,  19,
+     20,  20,  21,  22,  22,  23,  23,  24,  25,  25,  26,  26,  27,  28,  28,  29,
+     30,  30,  31,  32,  33,  33,  34,  35,  35,  36,  37,  38,  39,  39,  40,  41,
+     42,  43,  43,  44,  45,  46,  47,  48,  49,  49,  50,  51,  52,  53,  54,  55,
+     56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,
+     73,  74,  75,  76,  77,  78,  79,  81,  82,  83,  84,  85,  87,  88,  89,  90,
+     91,  93,  94,  95,  97,  98,  99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+    113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+    137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+    163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+    192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+    223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255,
+};
 
 // FRAMES DA COR VERDE =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
-Led_frame green_frame1 = {{
-    {0,0,0},   {0,0,0},   {0,255,0}, {0,0,0},   {0,0,0}, 
-    {0,0,0},   {0,0,0},   {0,0,0},   {0,255,0}, {0,0,0},
-    {0,255,0}, {0,255,0}, {0,255,0}, {0,255,0}, {0,255,0},
-    {0,0,0},   {0,0,0},   {0,0,0},   {0,255,0}, {0,0,0},
-    {0,0,0},   {0,0,0},   {0,255,0}, {0,0,0},   {0,0,0},
-}};
-
-Led_frame green_frame2 = {{
-    {0,0,0},   {0,0,0},   {0,0,0},   {0,255,0}, {0,0,0},
-    {0,0,0},   {0,0,0},   {0,0,0},   {0,0,0},   {0,255,0},
-    {0,0,0},   {0,255,0}, {0,255,0}, {0,255,0}, {0,255,0},
-    {0,0,0},   {0,0,0},   {0,0,0},   {0,0,0},   {0,255,0},
-    {0,0,0},   {0,0,0},   {0,0,0},   {0,255,0}, {0,0,0},
-}};
-
-Led_frame green_frame3 = {{
-    {0,0,0},   {0,0,0},   {0,0,0},   {0,0,0},   {0,255,0}, 
-    {0,0,0},   {0,0,0},   {0,0,0},   {0,0,0},   {0,0,0},   
-    {0,255,0}, {0,0,0},   {0,255,0}, {0,255,0}, {0,255,0},
-    {0,0,0},   {0,0,0},   {0,0,0},   {0,0,0},   {0,0,0},   
-    {0,0,0},   {0,0,0},   {0,0,0},   {0,0,0},   {0,255,0}, 
-}};
-
-Led_frame green_frame4 = {{
-    {0,0,0},   {0,0,0},   {0,0,0},   {0,0,0},   {0,0,0},   
-    {0,255,0}, {0,0,0},   {0,0,0},   {0,0,0},   {0,0,0},  
-    {0,255,0}, {0,255,0}, {0,0,0},   {0,255,0}, {0,255,0},
-    {0,255,0}, {0,0,0},   {0,0,0},   {0,0,0},   {0,0,0},    
-    {0,0,0},   {0,0,0},   {0,0,0},   {0,0,0},   {0,0,0},   
-}};
-
-Led_frame green_frame5 = {{
-    {0,255,0}, {0,0,0},   {0,0,0},   {0,0,0},   {0,0,0},     
-    {0,0,0},   {0,255,0}, {0,0,0},   {0,0,0},   {0,0,0},     
-    {0,255,0}, {0,255,0}, {0,255,0}, {0,0,0},   {0,255,0}, 
-    {0,0,0},   {0,255,0}, {0,0,0},   {0,0,0},   {0,0,0},      
-    {0,255,0}, {0,0,0},   {0,0,0},   {0,0,0},   {0,0,0},    
-}};
-
-Led_frame green_frame6 = {{
-    {0,0,0},   {0,255,0}, {0,0,0},   {0,0,0},   {0,0,0},     
-    {0,0,0},   {0,0,0},   {0,255,0}, {0,0,0},   {0,0,0},     
-    {0,255,0}, {0,255,0}, {0,255,0}, {0,255,0}, {0,0,0},   
-    {0,0,0},   {0,0,0},   {0,255,0}, {0,0,0},   {0,0,0},        
-    {0,0,0},   {0,255,0}, {0,0,0},   {0,0,0},   {0,0,0},     
-}};
-// Faz referência aos frames criados anteriormente
-Led_frame *green_frames[] = {
-    &green_frame1, 
-    &green_frame2, 
-    &green_frame3, 
-    &green_frame4, 
-    &green_frame5,
-    &green_frame6, 
+static const uint32_t green_frames[][NUM_PIXELS] = {
+    // Frame 1
+    LED_FRAME(
+        APAG, APAG, VERD, APAG, APAG,
+        APAG, APAG, APAG, VERD, APAG,
+        VERD, VERD, VERD, VERD, VERD,
+        APAG, APAG, APAG, VERD, APAG,
+        APAG, APAG, VERD, APAG, APAG
+    ),
+    // Frame 2
+    LED_FRAME(
+        APAG, APAG, APAG, VERD, APAG,
+        APAG, APAG, APAG, APAG, VERD,
+        APAG, VERD, VERD, VERD, VERD,
+        APAG, APAG, APAG, APAG, VERD,
+        APAG, APAG, APAG, VERD, APAG
+    ),
+    // Frame 3
+    LED_FRAME(
+        APAG, APAG, APAG, APAG, VERD,
+        APAG, APAG, APAG, APAG, APAG,
+        VERD, APAG, VERD, VERD, VERD,
+        APAG, APAG, APAG, APAG, APAG,
+        APAG, APAG, APAG, APAG, VERD
+    ),
+    // Frame 4
+    LED_FRAME(
+        APAG, APAG, APAG, APAG, APAG,
+        VERD, APAG, APAG, APAG, APAG,
+        VERD, VERD, APAG, VERD, VERD,
+        VERD, APAG, APAG, APAG, APAG,
+        APAG, APAG, APAG, APAG, APAG
+    ),
+    // Frame 5
+    LED_FRAME(
+        VERD, APAG, APAG, APAG, APAG,
+        APAG, VERD, APAG, APAG, APAG,
+        VERD, VERD, VERD, APAG, VERD,
+        APAG, VERD, APAG, APAG, APAG,
+        VERD, APAG, APAG, APAG, APAG
+    ),
+    // Frame 6
+    LED_FRAME(
+        APAG, VERD, APAG, APAG, APAG,
+        APAG, APAG, VERD, APAG, APAG,
+        VERD, VERD, VERD, VERD, APAG,
+        APAG, APAG, VERD, APAG, APAG,
+        APAG, VERD, APAG, APAG, APAG
+    ),
 };
+#define NUM_GREEN_FRAMES (sizeof(green_frames) / sizeof(green_frames[0]))
 
 // FRAME DA COR AMARELA =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
-Led_frame yellow_frame = {{
-    {0,0,0}, {0,0,0}, {255,255,0}, {0,0,0}, {0,0,0}, 
-    {0,0,0}, {0,0,0}, {255,255,0}, {0,0,0}, {0,0,0}, 
-    {0,0,0}, {0,0,0}, {255,255,0}, {0,0,0}, {0,0,0}, 
-    {0,0,0}, {0,0,0},   {0,0,0},   {0,0,0}, {0,0,0}, 
-    {0,0,0}, {0,0,0}, {255,255,0}, {0,0,0}, {0,0,0}, 
-}};
+static const uint32_t yellow_frame[NUM_PIXELS] = LED_FRAME(
+    APAG, APAG, AMAR, APAG, APAG,
+    APAG, APAG, AMAR, APAG, APAG,
+    APAG, APAG, AMAR, APAG, APAG,
+    APAG, APAG, APAG, APAG, APAG,
+    APAG, APAG, AMAR, APAG, APAG
+);
 
 // FRAME DA COR VERMELHA =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
-Led_frame red_frame = {{
-    {0,0,0},     {255,0,0},     {255,0,0},     {255,0,0},    {0,0,0},
-    {255,0,0}, {255,255,255}, {255,255,255}, {255,255,255}, {255,0,0},
-    {255,0,0}, {255,255,255},   {255,0,0},   {255,255,255}, {255,0,0},
-    {255,0,0}, {255,255,255}, {255,255,255}, {255,255,255}, {255,0,0},
-    {0,0,0},     {255,0,0},     {255,0,0},     {255,0,0},    {0,0,0},
-}};
-
-static inline void put_pixel(uint32_t pixel_grb){
-    pio_sm_put_blocking(pio0, 0, pixel_grb << 8u);
+static const uint32_t red_frame[NUM_PIXELS] = LED_FRAME(
+    APAG, VERM, VERM, VERM, APAG,
+    VERM, BRAN, BRAN, BRAN, VERM,
+    VERM, BRAN, VERM, BRAN, VERM,
+    VERM, BRAN, BRAN, BRAN, VERM,
+    APAG, VERM, VERM, VERM, APAG
+);
+
+// PIO/SM que geram o sinal da matriz, definidos em led_matrix_init
+static PIO matrix_pio;
+static uint matrix_sm;
+// Buffer de saída no formato da FIFO (GRB alinhado à esquerda), lido pela DMA
+static uint32_t wire_buffer[NUM_PIXELS];
+static int matrix_dma_chan;
+static volatile bool matrix_busy = false;
+static led_matrix_callback_t matrix_callback = NULL;
+static void *matrix_callback_ctx = NULL;
+// Palavras enviadas à FIFO da PIO desde o início, para medições
+static uint32_t matrix_words_sent = 0;
+
+// Fim do latch: a FIFO esvaziou e a linha ficou em nível baixo pelo tempo de reset
+static int64_t matrix_latch_done(alarm_id_t id, void *user_data){
+    trace_log(TRACE_MATRIZ_LATCH, 0);
+    matrix_busy = false;
+    if(matrix_callback){
+        matrix_callback(matrix_callback_ctx);
+    }
+    return 0;
+}
+
+// A DMA termina quando a última palavra entra na FIFO: ainda faltam a FIFO (8 palavras),
+// o OSR e o tempo de reset antes de um novo frame poder ser enviado
+static void matrix_dma_irq_handler(void){
+    if(dma_channel_get_irq0_status(matrix_dma_chan)){
+        dma_channel_acknowledge_irq0(matrix_dma_chan);
+        trace_log(TRACE_MATRIZ_DMA_FIM, 0);
+        uint32_t drain_us = 9 * 24 * 1000000u / LED_MATRIX_FREQ;
+        // Sem alarme livre, o latch é esperado aqui mesmo (~0,6ms na ISR) para a matriz não ficar ocupada para sempre
+        if(add_alarm_in_us(drain_us + LED_MATRIX_RESET_US, matrix_latch_done, NULL, true) < 0){
+            busy_wait_us(drain_us + LED_MATRIX_RESET_US);
+            matrix_latch_done(0, NULL);
+        }
+    }
+}
+
+// Carrega o programa ws2812 no PIO/SM escolhidos e prepara o canal de DMA cadenciado pelo DREQ de TX
+void led_matrix_init(PIO pio, uint sm, uint pin){
+    matrix_pio = pio;
+    matrix_sm = sm;
+    uint offset = pio_add_program(pio, &ws2812_program);
+    ws2812_program_init(pio, sm, offset, pin, LED_MATRIX_FREQ, false);
+
+    matrix_dma_chan = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(matrix_dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(pio, sm, true));
+    dma_channel_configure(matrix_dma_chan, &c, &pio->txf[sm], wire_buffer, NUM_PIXELS, false);
+
+    irq_add_shared_handler(DMA_IRQ_0, matrix_dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    dma_channel_set_irq0_enabled(matrix_dma_chan, true);
+    irq_set_enabled(DMA_IRQ_0, true);
+}
+
+void led_matrix_set_callback(led_matrix_callback_t callback, void *ctx){
+    matrix_callback = callback;
+    matrix_callback_ctx = ctx;
+}
+
+// Verdadeiro enquanto um frame está sendo transmitido ou travado nos LEDs
+bool led_matrix_busy(void){
+    return matrix_busy;
+}
+
+// Total de palavras entregues à PIO (um frame aceito por set_leds são NUM_PIXELS palavras)
+uint32_t led_matrix_words_sent(void){
+    return matrix_words_sent;
+}
+
+// Escala um canal de 8 bits da palavra de saída (ponto fixo Q16, sem ponto flutuante)
+static inline uint32_t scale_channel(uint32_t word, uint shift, uint32_t escala){
+    return ((((word >> shift) & 0xFF) * escala) >> 16) << shift;
 }
 
-// Função que vai transformar valores correspondentes ao padrão RGB em dados binários
-uint32_t urgb_u32(double r, double g, double b){
-    return ((uint32_t)(r) << 8) | ((uint32_t)(g) << 16) | (uint32_t)(b);
+// Escala de uma animação de pulso: nível de brilho percebido (0-255) aplicado sobre a escala
+// máxima através da curva de gama, para que o pulso pareça uniforme ao olho.
+// Com escalas pequenas (LED_SCALE(0.05)) a gama zera os primeiros níveis: nivel > 0 nunca apaga o pulso.
+uint16_t led_pulse_scale(uint16_t escala_max, uint8_t nivel){
+    uint32_t escala = (uint32_t)escala_max * led_gamma8[nivel] / 255;
+    return (escala == 0 && nivel > 0 && escala_max > 0) ? 1 : escala;
 }
 
-// Função que atualiza os Leds do vetor
-void set_leds(float intensidade){
-    uint32_t color; // Armazena os valores das cores
+// Função que atualiza os Leds: o frame já está na ordem de saída, então basta aplicar a
+// escala (Q16) palavra a palavra e disparar a DMA, retornando imediatamente.
+// Retorna false (e descarta o frame) se o anterior ainda não terminou.
+bool set_leds(const uint32_t *frame, uint16_t escala){
+    if(matrix_busy){
+        return false;
+    }
 
-    // Define todos os LEDs com a cor especificada
-    // Faz o processo de virar de cabeça para baixo o arranjo
-    for (int i = NUM_PIXELS-1; i >= 0; i--){
-        color = urgb_u32(intensidade*led_buffer.led[i].red, intensidade*led_buffer.led[i].green, intensidade*led_buffer.led[i].blue); // Converte as cores para o padrão aceito pela matriz
-        put_pixel(color); // Liga o LED com um no buffer
+    for (int i = 0; i < NUM_PIXELS; i++){
+        uint32_t word = frame[i];
+        wire_buffer[i] = scale_channel(word, 24, escala) | scale_channel(word, 16, escala) | scale_channel(word, 8, escala);
     }
+
+    matrix_busy = true;
+    matrix_words_sent += NUM_PIXELS;
+    dma_channel_transfer_from_buffer_now(matrix_dma_chan, wire_buffer, NUM_PIXELS);
+    return true;
 }
 
 // Cor verde
 void green_animation(uint frame_index){
-    // Ordenando corretamente o vetor recebido no buffer
-    int j = 0; // Variável para controle do index espelhado
-    for(int i=0; i<25; i++){
-        if(i>4 && i<10){
-            led_buffer.led[i] = green_frames[frame_index]->led[9-j];
-            j++;
-        }
-        else if(i>14 && i<20){
-            led_buffer.led[i] = green_frames[frame_index]->led[19-j];
-            j++;
-        }
-        else{
-            j=0;
-            led_buffer.led[i] = green_frames[frame_index]->led[i];
-        }
-    }
-    set_leds(0.05);
+    set_leds(green_frames[frame_index % NUM_GREEN_FRAMES], LED_SCALE(0.05));
 }
 
 // Cor amarela
-void yellow_animation(float intensidade){
-    // Ordenando corretamente o vetor recebido no buffer
-    int j = 0; // Variável para controle do index espelhado
-    for(int i=0; i<25; i++){
-        if(i>4 && i<10){
-            led_buffer.led[i] = yellow_frame.led[9-j];
-            j++;
-        }
-        else if(i>14 && i<20){
-            led_buffer.led[i] = yellow_frame.led[19-j];
-            j++;
-        }
-        else{
-            j=0;
-            led_buffer.led[i] = yellow_frame.led[i];
-        }
-    }
-    set_leds(intensidade);
+void yellow_animation(uint16_t escala){
+    set_leds(yellow_frame, escala);
 }
 
 // Cor vermelha
-void red_animation(float intensidade){
-    // Ordenando corretamente o vetor recebido no buffer
-    int j = 0; // Variável para controle do index espelhado
-    for(int i=0; i<25; i++){
-        if(i>4 && i<10){
-            led_buffer.led[i] = red_frame.led[9-j];
-            j++;
-        }
-        else if(i>14 && i<20){
-            led_buffer.led[i] = red_frame.led[19-j];
-            j++;
-        }
-        else{
-            j=0;
-            led_buffer.led[i] = red_frame.led[i];
-        }
-    }
-    set_leds(intensidade);
+void red_animation(uint16_t escala){
+    set_leds(red_frame, escala);
 }
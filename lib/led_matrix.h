@@ -6,30 +6,48 @@
 #include "ws2812.pio.h"
 
 #define NUM_PIXELS 25
+// Frequência do protocolo WS2812 e tempo de reset (latch) após o último bit
+#define LED_MATRIX_FREQ 800000
+#define LED_MATRIX_RESET_US 300
+
+// Callback chamado (em contexto de interrupção) quando o frame foi enviado e travado nos LEDs
+typedef void (*led_matrix_callback_t)(void *ctx);
+
+// Cor no formato de saída da PIO: G nos bits 31-24, R em 23-16 e B em 15-8
+#define LED_GRB(r, g, b) (((uint32_t)(g) << 24) | ((uint32_t)(r) << 16) | ((uint32_t)(b) << 8))
+
+// Monta um frame a partir do desenho visto de frente (linha de cima primeiro, da esquerda
+// para a direita), já na ordem em que os pixels saem pela PIO: o último LED da cadeia é
+// enviado primeiro e as linhas 1 e 3 da matriz são ligadas em sentido inverso (serpentina).
+#define LED_FRAME(p0, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14, \
+                  p15, p16, p17, p18, p19, p20, p21, p22, p23, p24) \
+    { p24, p23, p22, p21, p20, \
+      p15, p16, p17, p18, p19, \
+      p14, p13, p12, p11, p10, \
+      p5,  p6,  p7,  p8,  p9,  \
+      p4,  p3,  p2,  p1,  p0 }
+
+// Converte uma intensidade constante (0.0 a 1.0) para escala em ponto fixo Q16.
+// Usar apenas com constantes, para que a conversão aconteça na compilação.
+#define LED_SCALE(x) ((uint16_t)((x) * 65535.0 + 0.5))
 
-// Struct com a estrutura das cores
-typedef struct {
-    uint8_t red;
-    uint8_t green;
-    uint8_t blue;
-} Led_color;
+// Declaração das funções utilizadas na lib led_matrix
+void led_matrix_init(PIO pio, uint sm, uint pin);
 
-// Struct para armazenar a estrutura dos frames
-typedef struct {
-    Led_color led[NUM_PIXELS];
-} Led_frame;
+void led_matrix_set_callback(led_matrix_callback_t callback, void *ctx);
 
-// Declaração das funções utilizadas na lib led_matrix
-static inline void put_pixel(uint32_t pixel_grb);
+bool led_matrix_busy(void);
+
+uint32_t led_matrix_words_sent(void);
 
-uint32_t urgb_u32(double r, double g, double b);
+uint16_t led_pulse_scale(uint16_t escala_max, uint8_t nivel);
 
-void set_leds(float intensidade);
+bool set_leds(const uint32_t *frame, uint16_t escala);
 
 void green_animation(uint frame_index);
 
-void yellow_animation(float intensidade);
+void yellow_animation(uint16_t escala);
 
-void red_animation(float intensidade);
+void red_animation(uint16_t escala);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include "log.h"
+#include "hardware/sync.h"
+#include "task.h"
+
+// Anéis dos cores (ISRs e código de antes do escalonador), seguidos pelos das tasks
+#define LOG_ISR_RINGS 2
+#define LOG_RINGS (LOG_ISR_RINGS + LOG_TASK_RINGS)
+
+// Um produtor e um consumidor por anel: a cabeça só é escrita pelo produtor e a cauda só pela
+// task do log, então basta publicar cada índice depois do registro (release/acquire)
+typedef struct {
+    log_record_t registros[LOG_RING_SIZE];
+    uint32_t cabeca;
+    uint32_t cauda;
+    uint32_t cheio;            // Descartes por anel cheio (escritos pelo produtor)
+    uint32_t suprimidos;       // Descartes pelo limite de taxa (escritos pelo produtor)
+    uint32_t cheio_informado;  // Já informados pela task do log
+    uint32_t suprimidos_informado;
+    const char *nome;
+} log_ring_t;
+
+static log_ring_t aneis[LOG_RINGS] = {
+    [0] = {.nome = "ISR core 0"},
+    [1] = {.nome = "ISR core 1"},
+};
+static uint32_t aneis_tasks = 0;
+// Registros de tasks que chegaram depois de todos os anéis distribuídos
+static uint32_t sem_anel = 0;
+static uint32_t sem_anel_informado = 0;
+// Até a task do log rodar (main, antes do escalonador), tudo vai para o anel do core
+static volatile bool log_ativo = false;
+
+static StackType_t log_stack[LOG_STACK];
+static StaticTask_t log_tcb;
+
+// Primeiro registro da task: reserva um anel do conjunto, que fica com ela para sempre
+static log_ring_t *log_claim(void){
+    log_ring_t *anel = NULL;
+    taskENTER_CRITICAL();
+    if(aneis_tasks < LOG_TASK_RINGS){
+        anel = &aneis[LOG_ISR_RINGS + aneis_tasks];
+        anel->nome = pcTaskGetName(NULL);
+        __atomic_store_n(&aneis_tasks, aneis_tasks + 1, __ATOMIC_RELEASE);
+    }
+    else{
+        sem_anel++;
+    }
+    taskEXIT_CRITICAL();
+    if(anel){
+        vTaskSetThreadLocalStoragePointer(NULL, LOG_TLS_RING, anel);
+    }
+    return anel;
+}
+
+static bool log_push(log_ring_t *anel, log_limit_t *limite, uint32_t agora, const char *formato,
+                     uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d){
+    // O limite é de um ponto de log, que pode ser compartilhado: uma corrida só deixa passar uma linha a mais
+    if(limite){
+        if(limite->usado && agora - limite->ultimo_us < limite->intervalo_us){
+            anel->suprimidos++;
+            return false;
+        }
+        limite->ultimo_us = agora;
+        limite->usado = true;
+    }
+    uint32_t cabeca = anel->cabeca;
+    if(cabeca - __atomic_load_n(&anel->cauda, __ATOMIC_ACQUIRE) == LOG_RING_SIZE){
+        anel->cheio++;
+        return false;
+    }
+    log_record_t *r = &anel->registros[cabeca & (LOG_RING_SIZE - 1)];
+    r->tempo_us = agora;
+    r->formato = formato;
+    r->args[0] = a;
+    r->args[1] = b;
+    r->args[2] = c;
+    r->args[3] = d;
+    __atomic_store_n(&anel->cabeca, cabeca + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool log_write(log_limit_t *limite, const char *formato, uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d){
+    uint32_t agora = time_us_32();
+    if(__get_current_exception() || !log_ativo){
+        // ISRs aninhadas escrevem no mesmo anel do core: as interrupções ficam bloqueadas só durante a cópia,
+        // então nada mais roda naquele core entre a reserva e a publicação
+        uint32_t irq = save_and_disable_interrupts();
+        bool ok = log_push(&aneis[get_core_num()], limite, agora, formato, a, b, c, d);
+        restore_interrupts(irq);
+        return ok;
+    }
+    log_ring_t *anel = pvTaskGetThreadLocalStoragePointer(NULL, LOG_TLS_RING);
+    if(!anel && !(anel = log_claim())){
+        return false;
+    }
+    return log_push(anel, limite, agora, formato, a, b, c, d);
+}
+
+bool log_read(log_record_t *r){
+    log_ring_t *escolhido = NULL;
+    uint32_t tempo_us = 0;
+    uint num_aneis = LOG_ISR_RINGS + __atomic_load_n(&aneis_tasks, __ATOMIC_ACQUIRE);
+    // O mais antigo entre os primeiros de cada anel (cada anel já está em ordem)
+    for(uint i = 0; i < num_aneis; i++){
+        log_ring_t *anel = &aneis[i];
+        uint32_t cauda = anel->cauda;
+        if(__atomic_load_n(&anel->cabeca, __ATOMIC_ACQUIRE) == cauda){
+            continue;
+        }
+        uint32_t tempo = anel->registros[cauda & (LOG_RING_SIZE - 1)].tempo_us;
+        if(!escolhido || (int32_t)(tempo - tempo_us) < 0){
+            escolhido = anel;
+            tempo_us = tempo;
+        }
+    }
+    if(!escolhido){
+        return false;
+    }
+    *r = escolhido->registros[escolhido->cauda & (LOG_RING_SIZE - 1)];
+    __atomic_store_n(&escolhido->cauda, escolhido->cauda + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// Descartes desde o último aviso, por anel
+static void log_report_drops(void){
+    uint num_aneis = LOG_ISR_RINGS + __atomic_load_n(&aneis_tasks, __ATOMIC_ACQUIRE);
+    for(uint i = 0; i < num_aneis; i++){
+        log_ring_t *anel = &aneis[i];
+        uint32_t cheio = __atomic_load_n(&anel->cheio, __ATOMIC_RELAXED);
+        uint32_t suprimidos = __atomic_load_n(&anel->suprimidos, __ATOMIC_RELAXED);
+        if(cheio != anel->cheio_informado || suprimidos != anel->suprimidos_informado){
+            printf("(LOG) %s: %lu linhas descartadas com o anel cheio, %lu pelo limite de taxa\n", anel->nome,
+                   (unsigned long)(cheio - anel->cheio_informado), (unsigned long)(suprimidos - anel->suprimidos_informado));
+            anel->cheio_informado = cheio;
+            anel->suprimidos_informado = suprimidos;
+        }
+    }
+    uint32_t perdidos = sem_anel;
+    if(perdidos != sem_anel_informado){
+        printf("(LOG) %lu linhas descartadas sem anel livre (LOG_TASK_RINGS)\n", (unsigned long)(perdidos - sem_anel_informado));
+        sem_anel_informado = perdidos;
+    }
+}
+
+// Única task que escreve os logs no stdio: o printf pode bloquear por ms sem atrasar quem registrou
+static void vLogTask(void *param){
+    uint32_t espera_ms = LOG_POLL_MIN_MS;
+    log_record_t r;
+    log_ativo = true;
+    while(true){
+        bool imprimiu = false;
+        while(log_read(&r)){
+            printf(r.formato, r.args[0], r.args[1], r.args[2], r.args[3]);
+            imprimiu = true;
+        }
+        log_report_drops();
+        // Sem registros, acorda cada vez menos (menos saídas do tickless idle)
+        espera_ms = imprimiu ? LOG_POLL_MIN_MS : espera_ms * 2;
+        if(espera_ms > LOG_POLL_MAX_MS){
+            espera_ms = LOG_POLL_MAX_MS;
+        }
+        vTaskDelay(pdMS_TO_TICKS(espera_ms));
+    }
+}
+
+void log_init(void){
+    xTaskCreateStatic(vLogTask, "Log", LOG_STACK, NULL, tskIDLE_PRIORITY, log_stack, &log_tcb);
+}
@@ -0,0 +1,61 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include "pico/stdlib.h"
+#include "FreeRTOS.h"
+
+// Log adiado: quem registra (task ou ISR) só copia o formato, os argumentos e o tempo para um
+// anel próprio, sem trava e sem esperar pelo stdio. Uma única task, na menor prioridade, formata
+// os registros de todos os anéis em ordem de tempo e os envia pelo stdio.
+//   - Cada task ganha um anel do conjunto no primeiro registro (guardado no seu thread local
+//     storage); as ISRs e o main, antes do escalonador, usam o anel do core.
+//   - Anel cheio ou limite de taxa: o registro é descartado e contado, e a task do log informa
+//     os descartes com uma linha "(LOG) ...".
+// O formato e os argumentos %s precisam continuar válidos até a impressão (literais de string).
+// Os argumentos viram uintptr_t: use %lu, %lx ou %ld, que têm o mesmo tamanho no RP2040 e no host.
+// No RP2040 o uintptr_t tem 32 bits: valores de 64 bits precisam de um cast (uint32_t) explícito.
+#define LOG_MAX_ARGS 4
+// Registros por anel (potência de 2)
+#define LOG_RING_SIZE 16
+// Anéis para as tasks, além dos dois das ISRs
+#define LOG_TASK_RINGS 6
+// Ponteiro de thread local storage com o anel da task (o 0 é do task_monitor)
+#define LOG_TLS_RING 1
+// Intervalo da task do log: volta ao mínimo quando houve registros e dobra até o máximo sem eles (em ms)
+#define LOG_POLL_MIN_MS 20
+#define LOG_POLL_MAX_MS 500
+#ifndef LOG_STACK
+#define LOG_STACK 512
+#endif
+
+typedef struct {
+    uint32_t tempo_us;         // time_us_32() no registro
+    const char *formato;
+    uintptr_t args[LOG_MAX_ARGS];
+} log_record_t;
+
+// Limite de taxa de um ponto de log: no máximo um registro a cada intervalo_us
+typedef struct {
+    uint32_t intervalo_us;
+    uint32_t ultimo_us;
+    bool usado;
+} log_limit_t;
+
+// Registra uma linha no formato do printf, com até LOG_MAX_ARGS argumentos
+#define LOG(...) LOG_ARGS_(NULL, __VA_ARGS__, 0, 0, 0, 0, 0)
+// Como LOG, mas descarta as linhas que vierem a menos de intervalo_ms da última deste ponto
+#define LOG_RATE(intervalo_ms, ...) do{ \
+        static log_limit_t log_limite_ = {(intervalo_ms) * 1000u, 0, false}; \
+        LOG_ARGS_(&log_limite_, __VA_ARGS__, 0, 0, 0, 0, 0); \
+    }while(0)
+#define LOG_ARGS_(limite, formato, a, b, c, d, ...) \
+    log_write(limite, formato, (uintptr_t)(a), (uintptr_t)(b), (uintptr_t)(c), (uintptr_t)(d))
+
+// Cria a task do log, na menor prioridade. Antes dela os registros esperam no anel do core.
+void log_init(void);
+// Registra sem bloquear: algumas dezenas de instruções, em task ou ISR. Retorna false se descartou.
+bool log_write(log_limit_t *limite, const char *formato, uintptr_t a, uintptr_t b, uintptr_t c, uintptr_t d);
+// Retira o registro mais antigo de todos os anéis (só o consumidor: a task do log)
+bool log_read(log_record_t *r);
+
+#endif
@@ -0,0 +1,62 @@
+#include "pattern.h"
+#include "hardware/pwm.h"
+
+// Aplica o nível do passo atual em todas as saídas e agenda o próximo passo
+static void pattern_apply_step(pattern_channel_t *ch){
+    const pattern_step_t *passo = &ch->padrao->passos[ch->passo];
+    uint nivel = ch->wrap * passo->nivel / 100;
+    for(uint8_t i = 0; i < ch->num_gpios; i++){
+        pwm_set_gpio_level(ch->gpios[i], nivel);
+    }
+    if(passo->duracao_ms){
+        // O período é contado do prazo do passo anterior, não de quando o callback rodou: um atraso
+        // da task de timers não se acumula ao longo do padrão. Passos já vencidos esperam um tick.
+        ch->prazo += pdMS_TO_TICKS(passo->duracao_ms);
+        TickType_t espera = ch->prazo - xTaskGetTickCount();
+        if((int32_t)espera <= 0){
+            espera = 1;
+        }
+        // Também (re)inicia o timer; o comando é tratado no mesmo tick pela task de timers
+        xTimerChangePeriod(ch->timer, espera, 0);
+    }
+}
+
+static void pattern_timer_expired(TimerHandle_t timer){
+    pattern_channel_t *ch = (pattern_channel_t *)pvTimerGetTimerID(timer);
+    if(!ch->padrao){
+        return;
+    }
+    ch->passo = (ch->passo + 1) % ch->padrao->num_passos;
+    pattern_apply_step(ch);
+}
+
+void pattern_channel_init(pattern_channel_t *ch, const uint *gpios, uint8_t num_gpios, uint wrap){
+    configASSERT(num_gpios <= PATTERN_MAX_GPIOS);
+    for(uint8_t i = 0; i < num_gpios; i++){
+        ch->gpios[i] = gpios[i];
+    }
+    ch->num_gpios = num_gpios;
+    ch->wrap = wrap;
+    ch->padrao = NULL;
+    ch->passo = 0;
+    ch->prazo = 0;
+    ch->timer = xTimerCreateStatic("Pattern", 1, pdFALSE, ch, pattern_timer_expired, &ch->timer_buffer);
+}
+
+void pattern_set(pattern_channel_t *ch, const pattern_t *padrao){
+    configASSERT(xTaskGetCurrentTaskHandle() == xTimerGetTimerDaemonTaskHandle());
+
+    // Um passo sem duração não reinicia o timer, então o anterior precisa ser parado
+    xTimerStop(ch->timer, 0);
+    ch->padrao = padrao;
+    ch->passo = 0;
+    ch->prazo = xTaskGetTickCount(); // O primeiro passo começa agora
+    if(padrao){
+        pattern_apply_step(ch);
+    }
+    else{
+        for(uint8_t i = 0; i < ch->num_gpios; i++){
+            pwm_set_gpio_level(ch->gpios[i], 0);
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include "pico/stdlib.h"
+#include "FreeRTOS.h"
+#include "timers.h"
+
+// Máximo de saídas PWM que um canal aciona em conjunto
+#define PATTERN_MAX_GPIOS 2
+
+// Passo de um padrão: nível aplicado e por quanto tempo
+typedef struct {
+    uint8_t nivel;        // Nível do PWM em % do wrap do canal
+    uint16_t duracao_ms;  // 0: mantém o nível até a próxima troca de padrão
+} pattern_step_t;
+
+// Padrão declarativo: os passos se repetem em ciclo (a menos que um deles tenha duração 0)
+typedef struct {
+    const pattern_step_t *passos;
+    uint8_t num_passos;
+} pattern_t;
+
+// Monta um pattern_t a partir da lista de passos, ex.: PATTERN({5, 250}, {0, 250})
+#define PATTERN(...) { \
+    (const pattern_step_t[]){__VA_ARGS__}, \
+    sizeof((const pattern_step_t[]){__VA_ARGS__}) / sizeof(pattern_step_t) \
+}
+
+// Canal do sequenciador: um timer one-shot da FreeRTOS avança os passos do padrão
+typedef struct {
+    uint gpios[PATTERN_MAX_GPIOS];
+    uint8_t num_gpios;
+    uint wrap;                // Wrap do PWM das saídas (nível de 100%)
+    const pattern_t *padrao;  // Padrão em execução (NULL: saídas desligadas)
+    uint8_t passo;
+    TickType_t prazo;         // Tick do fim do passo atual: o próximo passo conta a partir dele
+    TimerHandle_t timer;
+    StaticTimer_t timer_buffer;
+} pattern_channel_t;
+
+// Inicializa o canal com as saídas já configuradas como PWM (todas com o mesmo wrap)
+void pattern_channel_init(pattern_channel_t *ch, const uint *gpios, uint8_t num_gpios, uint wrap);
+// Troca o padrão do canal imediatamente, recomeçando pelo primeiro passo.
+// Deve ser chamada no contexto da task de timers (callback de timer ou xTimerPendFunctionCall),
+// o que serializa as trocas com o avanço dos passos.
+void pattern_set(pattern_channel_t *ch, const pattern_t *padrao);
+
+#endif
@@ -0,0 +1,154 @@
+#include <string.h>
+#include "plan_store.h"
+#include "pico/flash.h"
+
+static const plan_store_header_t *ativa = NULL;
+static const plan_store_header_t *em_uso = NULL;
+
+static inline const plan_store_header_t *plan_store_copy(uint i){
+    return (const plan_store_header_t *)(XIP_BASE + PLAN_STORE_OFFSET + i * FLASH_SECTOR_SIZE);
+}
+
+// CRC-32 refletido (polinômio 0xEDB88320) por nibble: tabela de 64 bytes, ~0,5 ms para um setor
+uint32_t plan_store_crc32(const void *dados, size_t tamanho){
+    static const uint32_t tabela[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    const uint8_t *p = dados;
+    uint32_t crc = 0xFFFFFFFF;
+    while(tamanho--){
+        crc ^= *p++;
+        crc = (crc >> 4) ^ tabela[crc & 0xF];
+        crc = (crc >> 4) ^ tabela[crc & 0xF];
+    }
+    return ~crc;
+}
+
+bool plan_store_valid(const plan_store_header_t *img, bool confere_crc){
+    if(img->magic != PLAN_STORE_MAGIC || img->formato != PLAN_STORE_FORMAT || img->num_planos == 0){
+        return false;
+    }
+    size_t tamanho = sizeof(plan_store_header_t) + img->num_planos * sizeof(plan_store_plan_t) +
+                     img->num_intervalos * sizeof(plan_interval_t) + img->num_horarios * sizeof(plan_store_schedule_t);
+    if(img->tamanho != tamanho || tamanho > PLAN_STORE_MAX_BYTES){
+        return false;
+    }
+    if(confere_crc && plan_store_crc32(&img->magic, tamanho - sizeof(img->crc)) != img->crc){
+        return false;
+    }
+
+    // Os índices das tabelas são usados sem nova verificação durante a execução
+    const plan_store_plan_t *planos = plan_store_plans(img);
+    const plan_interval_t *intervalos = plan_store_intervals(img);
+    for(uint i = 0; i < img->num_planos; i++){
+        if(planos[i].num_intervalos == 0 || planos[i].num_grupos == 0 || planos[i].num_grupos > PLAN_MAX_GROUPS ||
+           planos[i].primeiro_intervalo + planos[i].num_intervalos > img->num_intervalos){
+            return false;
+        }
+    }
+    for(uint i = 0; i < img->num_intervalos; i++){
+        if(intervalos[i].duracao_ms == 0 || intervalos[i].duracao_ms > PLAN_INTERVAL_MAX_MS){
+            return false;
+        }
+    }
+    const plan_store_schedule_t *horarios = plan_store_schedule(img);
+    for(uint i = 0; i < img->num_horarios; i++){
+        if(horarios[i].plano >= img->num_planos || horarios[i].inicio_min >= PLAN_STORE_MINUTES_PER_DAY ||
+           (i && horarios[i].inicio_min <= horarios[i - 1].inicio_min)){
+            return false;
+        }
+    }
+    return true;
+}
+
+const plan_store_header_t *plan_store_init(const plan_store_header_t *padrao){
+    ativa = padrao;
+    for(uint i = 0; i < PLAN_STORE_COPIES; i++){
+        const plan_store_header_t *copia = plan_store_copy(i);
+        // Comparação com a volta da sequência de 32 bits
+        if(plan_store_valid(copia, true) && (ativa == padrao || (int32_t)(copia->sequencia - ativa->sequencia) > 0)){
+            ativa = copia;
+        }
+    }
+    return ativa;
+}
+
+const plan_store_header_t *plan_store_active(void){
+    return ativa;
+}
+
+const plan_store_header_t *plan_store_acquire(void){
+    em_uso = ativa;
+    return ativa;
+}
+
+void plan_store_release(void){
+    em_uso = NULL;
+}
+
+void plan_store_get(const plan_store_header_t *img, uint indice, plan_t *plano){
+    const plan_store_plan_t *p = &plan_store_plans(img)[indice];
+    plano->intervalos = &plan_store_intervals(img)[p->primeiro_intervalo];
+    plano->num_intervalos = p->num_intervalos;
+    plano->num_grupos = p->num_grupos;
+}
+
+uint plan_store_select(const plan_store_header_t *img, uint minuto){
+    const plan_store_schedule_t *horarios = plan_store_schedule(img);
+    if(img->num_horarios == 0){
+        return 0;
+    }
+    uint plano = horarios[img->num_horarios - 1].plano; // Vem do dia anterior
+    for(uint i = 0; i < img->num_horarios && horarios[i].inicio_min <= minuto; i++){
+        plano = horarios[i].plano;
+    }
+    return plano;
+}
+
+typedef struct {
+    uint32_t offset;
+    const uint8_t *dados;
+    size_t tamanho;
+} plan_store_gravacao_t;
+
+// Executada com o outro core e as interrupções travados (o XIP fica indisponível)
+static void plan_store_flash(void *param){
+    const plan_store_gravacao_t *g = param;
+    static uint8_t pagina[FLASH_PAGE_SIZE];
+    flash_range_erase(g->offset, FLASH_SECTOR_SIZE);
+    for(size_t feito = 0; feito < g->tamanho; feito += FLASH_PAGE_SIZE){
+        size_t n = g->tamanho - feito < FLASH_PAGE_SIZE ? g->tamanho - feito : FLASH_PAGE_SIZE;
+        memset(pagina, 0xFF, sizeof(pagina));
+        memcpy(pagina, g->dados + feito, n);
+        flash_range_program(g->offset + feito, pagina, FLASH_PAGE_SIZE);
+    }
+}
+
+bool plan_store_write(plan_store_header_t *img){
+    // Enquanto o controlador não adotar a imagem ativa, a anterior (no outro setor) segue em uso
+    if(em_uso && em_uso != ativa){
+        return false;
+    }
+
+    // O destino é a cópia que não está ativa (com a imagem padrão, a primeira)
+    uint destino = ativa == plan_store_copy(0) ? 1 : 0;
+    img->sequencia = ativa->sequencia + 1;
+    img->crc = plan_store_crc32(&img->magic, img->tamanho - sizeof(img->crc));
+    if(!plan_store_valid(img, false)){
+        return false;
+    }
+
+    plan_store_gravacao_t g = {PLAN_STORE_OFFSET + destino * FLASH_SECTOR_SIZE, (const uint8_t *)img, img->tamanho};
+    if(flash_safe_execute(plan_store_flash, &g, PLAN_STORE_TIMEOUT_MS) != PICO_OK){
+        return false;
+    }
+    // Só passa a valer depois de conferida pelo XIP: um corte de energia no meio da gravação
+    // deixa a cópia nova inválida e a anterior continua ativa no próximo boot
+    const plan_store_header_t *nova = plan_store_copy(destino);
+    if(!plan_store_valid(nova, true)){
+        return false;
+    }
+    ativa = nova;
+    return true;
+}
@@ -0,0 +1,87 @@
+#ifndef PLAN_STORE_H
+#define PLAN_STORE_H
+
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "signal_plan.h"
+
+// Imagem dos planos de temporização na flash, lida no lugar pelo XIP: o cabeçalho é seguido
+// pelos descritores dos planos, pelos intervalos de todos os planos e pela tabela de horários,
+// todos no formato das structs abaixo (little-endian, alinhados em 4 bytes). Duas cópias em
+// setores distintos; vale a válida de maior sequência, e uma gravação sempre vai para a outra.
+#define PLAN_STORE_MAGIC 0x4E4C5053 // "SPLN"
+#define PLAN_STORE_FORMAT 2 // 2: duracao_ms de 32 bits (antes, 16 bits seguidos de enchimento)
+#define PLAN_STORE_COPIES 2
+// Os dois últimos setores da flash (fora do alcance do binário do firmware)
+#define PLAN_STORE_OFFSET (PICO_FLASH_SIZE_BYTES - PLAN_STORE_COPIES * FLASH_SECTOR_SIZE)
+#define PLAN_STORE_MAX_BYTES FLASH_SECTOR_SIZE
+// Tempo máximo para travar o outro core antes de apagar/gravar a flash (ms)
+#define PLAN_STORE_TIMEOUT_MS 100
+#define PLAN_STORE_MINUTES_PER_DAY (24 * 60)
+
+typedef struct {
+    uint32_t crc;              // CRC-32 (o mesmo do zlib) de todos os bytes seguintes, até tamanho
+    uint32_t magic;
+    uint16_t formato;          // Versão deste layout
+    uint16_t tamanho;          // Bytes da imagem, cabeçalho incluído
+    uint32_t sequencia;        // Incrementada a cada gravação
+    uint32_t versao;           // Versão do conjunto de planos, definida por quem gera a imagem
+    uint16_t num_planos;
+    uint16_t num_intervalos;
+    uint16_t num_horarios;
+    uint16_t reservado;
+} plan_store_header_t;
+
+// Plano: faixa de intervalos na tabela comum
+typedef struct {
+    uint16_t primeiro_intervalo;
+    uint16_t num_intervalos;
+    uint8_t num_grupos;
+    uint8_t reservado[3];
+} plan_store_plan_t;
+
+// Troca de plano por horário: vale de inicio_min até o próximo horário (a tabela é ordenada,
+// e antes do primeiro horário do dia vale o último do dia anterior)
+typedef struct {
+    uint16_t inicio_min;       // Minuto do dia (0-1439)
+    uint8_t plano;
+    uint8_t reservado;
+} plan_store_schedule_t;
+
+// O layout é o contrato com quem gera a imagem: tamanhos fixos, sem preenchimento entre as tabelas
+_Static_assert(sizeof(plan_store_header_t) == 28 && sizeof(plan_store_plan_t) == 8 &&
+               sizeof(plan_interval_t) == 8 && sizeof(plan_store_schedule_t) == 4, "layout da imagem de planos");
+
+// Acesso às tabelas da imagem (só aritmética de ponteiros, sem cópia)
+static inline const plan_store_plan_t *plan_store_plans(const plan_store_header_t *img){
+    return (const plan_store_plan_t *)(img + 1);
+}
+static inline const plan_interval_t *plan_store_intervals(const plan_store_header_t *img){
+    return (const plan_interval_t *)(plan_store_plans(img) + img->num_planos);
+}
+static inline const plan_store_schedule_t *plan_store_schedule(const plan_store_header_t *img){
+    return (const plan_store_schedule_t *)(plan_store_intervals(img) + img->num_intervalos);
+}
+
+// Escolhe a cópia válida mais recente da flash; sem nenhuma, usa a imagem padrão compilada
+// no firmware (que não passa pelo CRC). Retorna a imagem ativa.
+const plan_store_header_t *plan_store_init(const plan_store_header_t *padrao);
+// Imagem ativa (muda após uma gravação bem-sucedida)
+const plan_store_header_t *plan_store_active(void);
+// Imagem ativa, marcada como em uso pelo controlador: o setor dela não é apagado até a próxima
+// chamada (que adota a imagem mais nova) ou até plan_store_release
+const plan_store_header_t *plan_store_acquire(void);
+void plan_store_release(void);
+// Descritor do plano indice apontando para os intervalos dentro da imagem
+void plan_store_get(const plan_store_header_t *img, uint indice, plan_t *plano);
+// Plano do horário (minuto do dia)
+uint plan_store_select(const plan_store_header_t *img, uint minuto);
+// Verifica uma imagem (CRC opcional) antes do uso: limites das tabelas e dos planos
+bool plan_store_valid(const plan_store_header_t *img, bool confere_crc);
+// Grava uma nova imagem no setor livre, preenchendo sequência e CRC (a imagem é alterada).
+// Falha se a imagem for inválida, se o controlador ainda não adotou a gravação anterior ou
+// se a flash não puder ser travada. Não pode ser chamada de uma ISR.
+bool plan_store_write(plan_store_header_t *img);
+uint32_t plan_store_crc32(const void *dados, size_t tamanho);
+
+#endif
@@ -0,0 +1,52 @@
+#include "power.h"
+#include "timers.h"
+#include "log.h"
+
+// Contadores do período atual do relatório
+static uint32_t wakeups = 0;
+static uint64_t slept_us = 0;
+static uint64_t sleep_start_us = 0;
+static uint64_t period_start_us = 0;
+static StaticTimer_t report_timer_buffer;
+
+static void power_report_timer(TimerHandle_t timer){
+    power_report();
+}
+
+void power_init(uint32_t report_ms){
+    period_start_us = time_us_64();
+    if(report_ms){
+        TimerHandle_t timer = xTimerCreateStatic("Power Report", pdMS_TO_TICKS(report_ms), pdTRUE, NULL, power_report_timer, &report_timer_buffer);
+        xTimerStart(timer, 0);
+    }
+}
+
+void power_pre_sleep(uint32_t ticks){
+    sleep_start_us = time_us_64();
+}
+
+// Cada retorno do sono é uma acordada do core (tick, interrupção ou prazo de uma task)
+void power_post_sleep(uint32_t ticks){
+    slept_us += time_us_64() - sleep_start_us;
+    wakeups++;
+}
+
+void power_report(void){
+    taskENTER_CRITICAL();
+    uint64_t agora = time_us_64();
+    uint64_t total_us = agora - period_start_us;
+    uint64_t dormindo_us = slept_us;
+    uint32_t acordadas = wakeups;
+    slept_us = 0;
+    wakeups = 0;
+    period_start_us = agora;
+    taskEXIT_CRITICAL();
+
+    if(!total_us){
+        return;
+    }
+    uint32_t dormindo_pct = dormindo_us * 100 / total_us;
+    uint32_t corrente_ua = (dormindo_us * POWER_SLEEP_UA + (total_us - dormindo_us) * POWER_RUN_UA) / total_us;
+    LOG("(POWER) %lu acordadas/%lus, dormindo %lu%%, corrente estimada %lu uA\n",
+        acordadas, (uint32_t)(total_us / 1000000), dormindo_pct, corrente_ua);
+}
@@ -0,0 +1,24 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include "pico/stdlib.h"
+#include "FreeRTOS.h"
+
+// Consumo estimado do RP2040 (em uA) para o relatório: rodando a 125 MHz e parado em WFI
+// durante o tickless idle. São estimativas; ajuste com uma medição da placa.
+#define POWER_RUN_UA 24000
+#define POWER_SLEEP_UA 8000
+
+// Período padrão do relatório (em ms)
+#define POWER_REPORT_MS 60000
+
+// Inicia a contagem e imprime o relatório a cada report_ms (0: sem relatório periódico)
+void power_init(uint32_t report_ms);
+// Chamadas pelo tickless idle (configPRE/POST_SLEEP_PROCESSING), com interrupções desabilitadas.
+// O tipo segue a declaração do FreeRTOSConfig.h, que não enxerga o TickType_t.
+void power_pre_sleep(uint32_t ticks);
+void power_post_sleep(uint32_t ticks);
+// Imprime acordadas, tempo dormindo e corrente média estimada desde o último relatório
+void power_report(void);
+
+#endif
@@ -0,0 +1,177 @@
+#include <string.h>
+#include "protocol.h"
+#include "plan_store.h"
+#include "pico/stdio.h"
+#include "task.h"
+
+// Quadro decodificado: comando, seq (e status na resposta), dados e CRC
+#define PROTOCOL_OVERHEAD 7
+// Um byte de código do COBS a cada 254 bytes, mais o primeiro
+#define COBS_MAX(n) ((n) + (n) / 254 + 1)
+#define PROTOCOL_RX_SIZE COBS_MAX(PROTOCOL_MAX_DATA + PROTOCOL_OVERHEAD)
+
+static const protocol_command_t *comandos_app;
+static uint num_comandos_app;
+static protocol_stats_t stats;
+
+// Recepção: os bytes entre dois 0x00 ficam aqui e são decodificados no lugar
+static uint8_t rx[PROTOCOL_RX_SIZE];
+static uint rx_tamanho = 0;
+static bool rx_estouro = false;
+// Envio: a resposta é montada em claro e codificada entre os dois delimitadores
+static uint8_t resposta[PROTOCOL_MAX_DATA + PROTOCOL_OVERHEAD];
+static uint8_t tx[COBS_MAX(sizeof(resposta)) + 2];
+
+static TaskHandle_t protocol_task;
+static StackType_t protocol_stack[PROTOCOL_STACK];
+static StaticTask_t protocol_tcb;
+
+// Decodifica o COBS no lugar (a saída nunca alcança a entrada). Retorna o tamanho, ou -1.
+static int cobs_decode(uint8_t *buf, uint tamanho){
+    uint lido = 0, escrito = 0;
+    while(lido < tamanho){
+        uint codigo = buf[lido++];
+        if(lido + codigo - 1 > tamanho){
+            return -1;
+        }
+        for(uint i = 1; i < codigo; i++){
+            buf[escrito++] = buf[lido++];
+        }
+        // Um código 0xFF é um bloco cheio, sem zero depois; o último bloco não tem zero
+        if(codigo < 0xFF && lido < tamanho){
+            buf[escrito++] = 0;
+        }
+    }
+    return escrito;
+}
+
+static uint cobs_encode(const uint8_t *origem, uint tamanho, uint8_t *destino){
+    uint pos_codigo = 0, escrito = 1;
+    uint8_t codigo = 1;
+    for(uint i = 0; i < tamanho; i++){
+        if(origem[i]){
+            destino[escrito++] = origem[i];
+            codigo++;
+        }
+        if(!origem[i] || codigo == 0xFF){
+            destino[pos_codigo] = codigo;
+            pos_codigo = escrito++;
+            codigo = 1;
+        }
+    }
+    destino[pos_codigo] = codigo;
+    return escrito;
+}
+
+static void protocol_send(uint tamanho_dados){
+    uint n = 3 + tamanho_dados;
+    uint32_t crc = plan_store_crc32(resposta, n);
+    memcpy(&resposta[n], &crc, sizeof(crc));
+    n += sizeof(crc);
+
+    tx[0] = 0;
+    uint codificado = cobs_encode(resposta, n, &tx[1]);
+    tx[codificado + 1] = 0;
+    // Uma única escrita, sem a tradução de \n para \r\n do stdio, que corromperia o quadro
+    stdio_put_string((const char *)tx, codificado + 2, false, false);
+    stats.quadros_tx++;
+}
+
+static void protocol_frame(uint tamanho){
+    int n = cobs_decode(rx, tamanho);
+    if(n < (int)(PROTOCOL_OVERHEAD - 1)){
+        stats.erros_cobs++;
+        return;
+    }
+    uint32_t crc;
+    memcpy(&crc, &rx[n - sizeof(crc)], sizeof(crc));
+    if(plan_store_crc32(rx, n - sizeof(crc)) != crc){
+        stats.erros_crc++;
+        return;
+    }
+    stats.quadros_rx++;
+
+    uint8_t comando = rx[0];
+    const uint8_t *dados = &rx[2];
+    uint tamanho_dados = n - sizeof(crc) - 2;
+    uint tamanho_resposta = 0;
+    protocol_status_t status = PROTOCOL_ERR_UNKNOWN;
+    if(tamanho_dados > PROTOCOL_MAX_DATA){
+        status = PROTOCOL_ERR_ARGS;
+    }
+    else if(comando == PROTOCOL_CMD_PING){
+        memcpy(&resposta[3], dados, tamanho_dados);
+        tamanho_resposta = tamanho_dados;
+        status = PROTOCOL_OK;
+    }
+    else if(comando == PROTOCOL_CMD_STATS){
+        memcpy(&resposta[3], &stats, sizeof(stats));
+        tamanho_resposta = sizeof(stats);
+        status = PROTOCOL_OK;
+    }
+    else{
+        for(uint i = 0; i < num_comandos_app; i++){
+            if(comandos_app[i].comando == comando){
+                status = comandos_app[i].handler(dados, tamanho_dados, &resposta[3], &tamanho_resposta);
+                break;
+            }
+        }
+    }
+    if(status != PROTOCOL_OK){
+        tamanho_resposta = 0;
+    }
+    resposta[0] = comando | PROTOCOL_REPLY;
+    resposta[1] = rx[1];
+    resposta[2] = status;
+    protocol_send(tamanho_resposta);
+}
+
+void protocol_feed(uint8_t byte){
+    stats.bytes_rx++;
+    if(byte == 0){
+        // Delimitadores seguidos (o 0x00 inicial de cada quadro) não são erro
+        if(rx_tamanho && !rx_estouro){
+            protocol_frame(rx_tamanho);
+        }
+        rx_tamanho = 0;
+        rx_estouro = false;
+        return;
+    }
+    if(rx_tamanho == sizeof(rx)){
+        if(!rx_estouro){
+            stats.estouros++;
+            rx_estouro = true; // Descarta o resto até o próximo delimitador
+        }
+        return;
+    }
+    rx[rx_tamanho++] = byte;
+}
+
+const protocol_stats_t *protocol_stats(void){
+    return &stats;
+}
+
+// Chamada pelo stdio (em interrupção) quando chegam caracteres: a leitura fica para a task
+static void protocol_chars_available(void *param){
+    BaseType_t higher_priority_woken = pdFALSE;
+    vTaskNotifyGiveFromISR(protocol_task, &higher_priority_woken);
+    portYIELD_FROM_ISR(higher_priority_woken);
+}
+
+// Esvazia as FIFOs do stdio direto no buffer do quadro; as tasks do semáforo nunca esperam por ela
+static void vProtocolTask(void *param){
+    while(true){
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int c;
+        while((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT){
+            protocol_feed(c);
+        }
+    }
+}
+
+void protocol_init(const protocol_command_t *comandos, uint num_comandos){
+    comandos_app = comandos;
+    num_comandos_app = num_comandos;
+    protocol_task = xTaskCreateStatic(vProtocolTask, "Protocol", PROTOCOL_STACK, NULL, tskIDLE_PRIORITY, protocol_stack, &protocol_tcb);
+    stdio_set_chars_available_callback(protocol_chars_available, NULL);
+}
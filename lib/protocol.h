@@ -0,0 +1,57 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include "pico/stdlib.h"
+#include "FreeRTOS.h"
+
+// Protocolo binário de comandos pelo stdio (USB CDC e UART). Cada quadro é codificado em COBS
+// e tem um 0x00 antes e depois, então o texto dos printf pode vir entre dois quadros sem
+// confundir o host. Conteúdo de um quadro (little-endian):
+//   pedido:   comando, seq, dados..., crc32
+//   resposta: comando | PROTOCOL_REPLY, seq, status, dados..., crc32
+// O CRC-32 (o mesmo do zlib e das imagens de planos) cobre todos os bytes anteriores.
+// Cliente de referência: tools/protocol_client.py
+#define PROTOCOL_MAX_DATA 240  // Dados de um pedido ou de uma resposta
+#define PROTOCOL_REPLY 0x80
+#ifndef PROTOCOL_STACK
+#define PROTOCOL_STACK 512
+#endif
+
+// Comandos do próprio protocolo; os da aplicação são registrados em protocol_init
+#define PROTOCOL_CMD_PING 0x00   // Ecoa os dados (teste de vazão)
+#define PROTOCOL_CMD_STATS 0x7F  // Contadores do protocolo (protocol_stats_t)
+
+typedef enum {
+    PROTOCOL_OK = 0,
+    PROTOCOL_ERR_UNKNOWN,        // Comando desconhecido
+    PROTOCOL_ERR_ARGS,           // Tamanho ou valor dos dados inválido
+    PROTOCOL_ERR_BUSY,           // Recurso ocupado, tentar de novo mais tarde
+    PROTOCOL_ERR_FAILED
+} protocol_status_t;
+
+// Trata um pedido: os dados foram decodificados no lugar, no buffer de recepção, e a resposta
+// (até PROTOCOL_MAX_DATA bytes) é escrita direto no buffer de envio. Roda na task do protocolo.
+typedef protocol_status_t (*protocol_handler_t)(const uint8_t *dados, uint tamanho, uint8_t *resposta, uint *tamanho_resposta);
+
+typedef struct {
+    uint8_t comando;
+    protocol_handler_t handler;
+} protocol_command_t;
+
+typedef struct {
+    uint32_t bytes_rx;
+    uint32_t quadros_rx;         // Pedidos válidos
+    uint32_t quadros_tx;
+    uint32_t erros_cobs;         // Quadro mal formado ou curto demais
+    uint32_t erros_crc;
+    uint32_t estouros;           // Quadro maior que o buffer de recepção (descartado)
+} protocol_stats_t;
+
+// Cria a task do protocolo, na menor prioridade, acordada pelo stdio quando chegam caracteres.
+// Substitui qualquer outro callback de caracteres disponíveis do stdio.
+void protocol_init(const protocol_command_t *comandos, uint num_comandos);
+// Trata um byte recebido: um 0x00 fecha o quadro, que é decodificado no lugar e respondido
+void protocol_feed(uint8_t byte);
+const protocol_stats_t *protocol_stats(void);
+
+#endif
@@ -0,0 +1,84 @@
+#include "signal_plan.h"
+
+// Soma de intervalos em ms (64 bits: um plano da flash pode ter centenas de intervalos de 24 h)
+// convertida para ticks, com a saturação em PLAN_TICKS_MAX
+static TickType_t plan_ms_to_ticks(uint64_t ms, TickType_t base){
+    uint64_t ticks = base + ms * configTICK_RATE_HZ / 1000;
+    return ticks < PLAN_TICKS_MAX ? (TickType_t)ticks : PLAN_TICKS_MAX;
+}
+
+void plan_start(plan_runner_t *r, const plan_t *plano, TickType_t agora, plan_output_t saida){
+    configASSERT(plano->num_grupos <= PLAN_MAX_GROUPS && plano->num_intervalos > 0);
+    r->plano = plano;
+    r->intervalo = 0;
+    r->estados = plano->intervalos[0].estados;
+    r->inicio = agora;
+    r->duracao = pdMS_TO_TICKS(plano->intervalos[0].duracao_ms);
+    r->saida = saida;
+    for(uint g = 0; g < plano->num_grupos; g++){
+        saida(r, g, plan_group_state(r, g));
+    }
+}
+
+void plan_advance(plan_runner_t *r){
+    r->inicio = plan_deadline(r); // O prazo deste intervalo é o início exato do próximo
+    r->intervalo = (r->intervalo + 1) % r->plano->num_intervalos;
+    r->duracao = pdMS_TO_TICKS(r->plano->intervalos[r->intervalo].duracao_ms);
+
+    uint32_t novos = r->plano->intervalos[r->intervalo].estados;
+    uint32_t mudou = novos ^ r->estados;
+    r->estados = novos;
+
+    // Um bit (o menor) por grupo alterado, percorridos do menor para o maior grupo
+    mudou = (mudou | (mudou >> 1)) & 0x55555555u;
+    while(mudou){
+        uint grupo = __builtin_ctz(mudou) / 2;
+        mudou &= mudou - 1;
+        r->saida(r, grupo, plan_group_state(r, grupo));
+    }
+}
+
+TickType_t plan_group_duration(const plan_runner_t *r, uint grupo){
+    const plan_t *plano = r->plano;
+    uint32_t mascara = PLAN_GROUP(grupo, 3);
+    uint32_t estado = r->estados & mascara;
+    uint64_t total_ms = 0;
+    // O intervalo atual entra com a duração em vigor, que pode ter sido encurtada
+    uint16_t i = (r->intervalo + 1) % plano->num_intervalos;
+    for(uint16_t n = 1; n < plano->num_intervalos; n++){
+        if((plano->intervalos[i].estados & mascara) != estado){
+            break;
+        }
+        total_ms += plano->intervalos[i].duracao_ms;
+        i = (i + 1) % plano->num_intervalos;
+    }
+    return plan_ms_to_ticks(total_ms, r->duracao);
+}
+
+TickType_t plan_time_until(const plan_runner_t *r, uint grupo, signal_state_t estado){
+    const plan_t *plano = r->plano;
+    uint32_t mascara = PLAN_GROUP(grupo, 3);
+    uint64_t total_ms = 0;
+    uint16_t i = (r->intervalo + 1) % plano->num_intervalos;
+    for(uint16_t n = 0; n < plano->num_intervalos; n++){
+        if((plano->intervalos[i].estados & mascara) == PLAN_GROUP(grupo, estado)){
+            return plan_ms_to_ticks(total_ms, 0);
+        }
+        total_ms += plano->intervalos[i].duracao_ms;
+        i = (i + 1) % plano->num_intervalos;
+    }
+    return portMAX_DELAY;
+}
+
+bool plan_shorten(plan_runner_t *r, TickType_t prazo){
+    TickType_t duracao = prazo - r->inicio;
+    // Comparação com a volta do contador de ticks: um prazo antes do início encerra o intervalo já
+    if((int32_t)duracao < 0){
+        duracao = 0;
+    }
+    if(duracao >= r->duracao){
+        return false;
+    }
+    r->duracao = duracao;
+    return true;
+}
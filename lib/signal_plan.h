@@ -0,0 +1,89 @@
+#ifndef SIGNAL_PLAN_H
+#define SIGNAL_PLAN_H
+
+#include "pico/stdlib.h"
+#include "FreeRTOS.h"
+
+// Máximo de grupos de sinal de um plano (2 bits de estado por grupo numa palavra de 32 bits)
+#define PLAN_MAX_GROUPS 16
+
+// Estado de um grupo de sinal (foco veicular ou de pedestres)
+typedef enum {
+    SIGNAL_RED = 0,     // Padrão: grupos não citados num intervalo ficam no vermelho
+    SIGNAL_GREEN,
+    SIGNAL_YELLOW,
+    SIGNAL_FLASH        // Vermelho piscante do pedestre (limpeza da travessia)
+} signal_state_t;
+
+// Estado de um grupo dentro da palavra de estados de um intervalo, ex.:
+// PLAN_GROUP(VIA_A, SIGNAL_GREEN) | PLAN_GROUP(PEDESTRE, SIGNAL_GREEN)
+#define PLAN_GROUP(grupo, estado) ((uint32_t)(estado) << (2 * (grupo)))
+
+// Intervalo do plano: o estado de todos os grupos durante duracao_ms. Um estágio é a
+// sequência de intervalos entre duas limpezas (todos no vermelho).
+typedef struct {
+    uint32_t estados;
+    uint32_t duracao_ms;  // De 32 bits: verdes longos (ex.: noturnos de minutos) passam de 65,5 s
+} plan_interval_t;
+// Duração máxima de um intervalo: mantém os prazos em ticks longe da volta do contador
+#define PLAN_INTERVAL_MAX_MS (24u * 60 * 60 * 1000)
+// Maior tempo informado por plan_group_duration e plan_time_until: os prazos são comparados pela
+// diferença com sinal, e a soma de vários intervalos longos passaria da metade do contador
+#define PLAN_TICKS_MAX ((TickType_t)INT32_MAX)
+
+// Plano cíclico: os intervalos se repetem em ordem
+typedef struct {
+    const plan_interval_t *intervalos;
+    uint16_t num_intervalos;
+    uint8_t num_grupos;
+} plan_t;
+
+// Monta um plan_t a partir da lista de intervalos, ex.: PLAN(2, {15000, ...}, {5000, ...})
+#define PLAN(grupos, ...) { \
+    (const plan_interval_t[]){__VA_ARGS__}, \
+    sizeof((const plan_interval_t[]){__VA_ARGS__}) / sizeof(plan_interval_t), \
+    (grupos) \
+}
+
+typedef struct plan_runner plan_runner_t;
+
+// Chamada a cada troca de estado de um grupo (na partida, para todos os grupos)
+typedef void (*plan_output_t)(const plan_runner_t *r, uint grupo, signal_state_t estado);
+
+// Execução de um plano: um único prazo avança todos os grupos
+struct plan_runner {
+    const plan_t *plano;
+    uint16_t intervalo;       // Intervalo atual
+    uint32_t estados;         // Estados aplicados (2 bits por grupo)
+    TickType_t inicio;        // Tick de início do intervalo atual (prazo absoluto, sem deriva)
+    TickType_t duracao;       // Duração do intervalo atual em ticks (a da tabela, ou menor após plan_shorten)
+    plan_output_t saida;
+};
+
+// Começa o plano pelo primeiro intervalo em agora, chamando a saída para todos os grupos
+void plan_start(plan_runner_t *r, const plan_t *plano, TickType_t agora, plan_output_t saida);
+// Passa ao próximo intervalo, que começa no prazo do atual, e chama a saída só para os
+// grupos que mudaram. O custo depende das trocas do intervalo, não da quantidade de grupos.
+void plan_advance(plan_runner_t *r);
+// Tick em que o intervalo atual termina
+static inline TickType_t plan_deadline(const plan_runner_t *r){
+    return r->inicio + r->duracao;
+}
+// Último intervalo do ciclo: no prazo dele o plano pode ser trocado sem cortar um estágio
+static inline bool plan_cycle_end(const plan_runner_t *r){
+    return r->intervalo == r->plano->num_intervalos - 1;
+}
+static inline signal_state_t plan_group_state(const plan_runner_t *r, uint grupo){
+    return (signal_state_t)((r->estados >> (2 * grupo)) & 3);
+}
+// Ticks, a partir do início do intervalo atual, até o grupo sair do estado atual
+// (o ciclo inteiro se ele nunca muda), limitados a PLAN_TICKS_MAX
+TickType_t plan_group_duration(const plan_runner_t *r, uint grupo);
+// Ticks do prazo do intervalo atual até o grupo entrar no estado, limitados a PLAN_TICKS_MAX
+// (portMAX_DELAY se não entra no ciclo)
+TickType_t plan_time_until(const plan_runner_t *r, uint grupo, signal_state_t estado);
+// Antecipa o prazo do intervalo atual (atuação). Retorna false se prazo não o encurta; um
+// prazo já vencido encerra o intervalo no próximo plan_advance.
+bool plan_shorten(plan_runner_t *r, TickType_t prazo);
+
+#endif
@@ -1,16 +1,96 @@
+#include <string.h>
 #include "ssd1306.h"
 #include "font.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "trace.h"
 
-void ssd1306_init(ssd1306_t *ssd, uint8_t width, uint8_t height, bool external_vcc, uint8_t address, i2c_inst_t *i2c) {
+// Display associado a cada bloco I2C, para o handler da DMA
+static ssd1306_t *ssd1306_dma_instances[2];
+
+static void ssd1306_dma_irq_handler(void) {
+  for (uint i = 0; i < 2; ++i) {
+    ssd1306_t *ssd = ssd1306_dma_instances[i];
+    if (ssd && dma_channel_get_irq0_status(ssd->dma_chan)) {
+      dma_channel_acknowledge_irq0(ssd->dma_chan);
+      trace_log(TRACE_DISPLAY_FIM, 0);
+      ssd->busy = false;
+      if (ssd->flush_callback)
+        ssd->flush_callback(ssd->flush_ctx);
+    }
+  }
+}
+
+// Configuração comum: os buffers já vêm alocados (heap ou estáticos) e zerados
+static void ssd1306_setup(ssd1306_t *ssd, uint8_t width, uint8_t height, bool external_vcc, uint8_t address, i2c_inst_t *i2c,
+                          uint8_t *ram_buffer, uint8_t *sent_buffer, uint16_t *tx_buffer) {
   ssd->width = width;
   ssd->height = height;
   ssd->pages = height / 8U;
   ssd->address = address;
   ssd->i2c_port = i2c;
   ssd->bufsize = ssd->pages * ssd->width + 1;
-  ssd->ram_buffer = calloc(ssd->bufsize, sizeof(uint8_t));
+  ssd->ram_buffer = ram_buffer;
   ssd->ram_buffer[0] = 0x40;
   ssd->port_buffer[0] = 0x80;
+  ssd->sent_buffer = sent_buffer;
+  ssd->tx_buffer = tx_buffer;
+  ssd->busy = false;
+  ssd->flush_callback = NULL;
+  ssd->flush_ctx = NULL;
+  ssd->bytes_sent = 0;
+  ssd1306_invalidate(ssd);
+
+  // DMA de 16 bits para o IC_DATA_CMD, cadenciada pelo DREQ de TX da I2C
+  ssd->dma_chan = dma_claim_unused_channel(true);
+  dma_channel_config c = dma_channel_get_default_config(ssd->dma_chan);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+  channel_config_set_read_increment(&c, true);
+  channel_config_set_write_increment(&c, false);
+  channel_config_set_dreq(&c, i2c_get_dreq(i2c, true));
+  dma_channel_configure(ssd->dma_chan, &c, &i2c_get_hw(i2c)->data_cmd, ssd->tx_buffer, 0, false);
+
+  if (!ssd1306_dma_instances[0] && !ssd1306_dma_instances[1])
+    irq_add_shared_handler(DMA_IRQ_0, ssd1306_dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+  ssd1306_dma_instances[i2c_hw_index(i2c)] = ssd;
+  dma_channel_set_irq0_enabled(ssd->dma_chan, true);
+  irq_set_enabled(DMA_IRQ_0, true);
+}
+
+void ssd1306_init(ssd1306_t *ssd, uint8_t width, uint8_t height, bool external_vcc, uint8_t address, i2c_inst_t *i2c) {
+  size_t bufsize = height / 8U * width + 1;
+  ssd1306_setup(ssd, width, height, external_vcc, address, i2c,
+                calloc(bufsize, sizeof(uint8_t)),
+                calloc(bufsize - 1, sizeof(uint8_t)),
+                calloc(bufsize + SSD1306_TX_HEADER - 1, sizeof(uint16_t)));
+}
+
+// Mesmo que ssd1306_init, mas com os buffers do chamador (tamanho fixo WIDTH x HEIGHT, sem heap)
+void ssd1306_init_static(ssd1306_t *ssd, bool external_vcc, uint8_t address, i2c_inst_t *i2c, ssd1306_buffers_t *buffers) {
+  memset(buffers, 0, sizeof(*buffers));
+  ssd1306_setup(ssd, WIDTH, HEIGHT, external_vcc, address, i2c, buffers->ram, buffers->sent, buffers->tx);
+}
+
+void ssd1306_set_flush_callback(ssd1306_t *ssd, ssd1306_flush_callback_t callback, void *ctx) {
+  ssd->flush_callback = callback;
+  ssd->flush_ctx = ctx;
+}
+
+// A I2C só terminou com a FIFO de transmissão vazia e sem atividade: o ACTIVITY pode ler 0 por
+// um instante entre dois bytes ainda na FIFO
+static inline bool ssd1306_i2c_idle(i2c_hw_t *hw) {
+  uint32_t status = hw->status;
+  return (status & I2C_IC_STATUS_TFE_BITS) && !(status & I2C_IC_STATUS_ACTIVITY_BITS);
+}
+
+bool ssd1306_busy(ssd1306_t *ssd) {
+  return ssd->busy || !ssd1306_i2c_idle(i2c_get_hw(ssd->i2c_port));
+}
+
+// Aguarda a DMA e o esvaziamento da FIFO da I2C (até o STOP do último byte)
+void ssd1306_wait(ssd1306_t *ssd) {
+  while (ssd1306_busy(ssd))
+    tight_loop_contents();
 }
 
 void ssd1306_config(ssd1306_t *ssd) {
@@ -41,7 +121,27 @@ void ssd1306_config(ssd1306_t *ssd) {
   ssd1306_command(ssd, SET_DISP | 0x01);
 }
 
+// Brilho do painel (0x00-0xFF): a corrente dos OLEDs é proporcional ao contraste
+void ssd1306_contrast(ssd1306_t *ssd, uint8_t contrast) {
+  ssd1306_command(ssd, SET_CONTRAST);
+  ssd1306_command(ssd, contrast);
+}
+
+// Desliga o painel e o charge pump (a GDDRAM é mantida), ou religa na ordem inversa
+void ssd1306_power(ssd1306_t *ssd, bool on) {
+  if (on) {
+    ssd1306_command(ssd, SET_CHARGE_PUMP);
+    ssd1306_command(ssd, 0x14);
+    ssd1306_command(ssd, SET_DISP | 0x01);
+  } else {
+    ssd1306_command(ssd, SET_DISP | 0x00);
+    ssd1306_command(ssd, SET_CHARGE_PUMP);
+    ssd1306_command(ssd, 0x10);
+  }
+}
+
 void ssd1306_command(ssd1306_t *ssd, uint8_t command) {
+  ssd1306_wait(ssd);
   ssd->port_buffer[1] = command;
   i2c_write_blocking(
     ssd->i2c_port,
@@ -50,22 +150,123 @@ void ssd1306_command(ssd1306_t *ssd, uint8_t command) {
     2,
     false
   );
+  ssd->bytes_sent += 2;
 }
 
+// Marca como alterada a região entre as colunas x0..x1 e páginas p0..p1
+static inline void ssd1306_mark_dirty(ssd1306_t *ssd, uint8_t x0, uint8_t p0, uint8_t x1, uint8_t p1) {
+  if (x0 < ssd->dirty_col_min) ssd->dirty_col_min = x0;
+  if (x1 > ssd->dirty_col_max) ssd->dirty_col_max = x1;
+  if (p0 < ssd->dirty_page_min) ssd->dirty_page_min = p0;
+  if (p1 > ssd->dirty_page_max) ssd->dirty_page_max = p1;
+}
+
+static inline void ssd1306_clear_dirty(ssd1306_t *ssd) {
+  ssd->dirty_col_min = 0xFF;
+  ssd->dirty_col_max = 0;
+  ssd->dirty_page_min = 0xFF;
+  ssd->dirty_page_max = 0;
+}
+
+// Força o reenvio do frame inteiro no próximo ssd1306_send_data
+void ssd1306_invalidate(ssd1306_t *ssd) {
+  ssd->sent_valid = false;
+  ssd1306_clear_dirty(ssd);
+  ssd1306_mark_dirty(ssd, 0, 0, ssd->width - 1, ssd->pages - 1);
+}
+
+// Reduz a região marcada aos bytes que realmente diferem do que já foi enviado
+static bool ssd1306_shrink_window(ssd1306_t *ssd, uint8_t *c0, uint8_t *p0, uint8_t *c1, uint8_t *p1) {
+  uint8_t col_min = 0xFF, col_max = 0, page_min = 0xFF, page_max = 0;
+  for (uint16_t x = *c0; x <= *c1; ++x) {
+    const uint8_t *ram = &ssd->ram_buffer[x * ssd->pages + 1];
+    const uint8_t *sent = &ssd->sent_buffer[x * ssd->pages];
+    for (uint8_t p = *p0; p <= *p1; ++p) {
+      if (ram[p] != sent[p]) {
+        if (x < col_min) col_min = x;
+        col_max = x;
+        if (p < page_min) page_min = p;
+        if (p > page_max) page_max = p;
+      }
+    }
+  }
+  if (col_min > col_max)
+    return false;
+  *c0 = col_min; *c1 = col_max;
+  *p0 = page_min; *p1 = page_max;
+  return true;
+}
+
+// Envia apenas os bytes alterados desde o último envio. Como o display opera no modo de
+// endereçamento vertical, a janela é percorrida coluna a coluna, página a página.
+// Os bytes são copiados para o front buffer e transmitidos pela DMA: a função retorna
+// imediatamente e o ram_buffer (back buffer) já pode ser redesenhado. Retorna true se
+// um envio foi iniciado; o fim dele é sinalizado pelo callback de ssd1306_set_flush_callback.
+// Retorna false com a DMA ainda ativa: a FIFO da I2C, esvaziada depois do callback, é esperada aqui.
+bool ssd1306_send_data_async(ssd1306_t *ssd) {
+  if (ssd->busy)
+    return false;
+  if (ssd->dirty_col_min > ssd->dirty_col_max || ssd->dirty_page_min > ssd->dirty_page_max)
+    return false;
+
+  uint8_t c0 = ssd->dirty_col_min, c1 = ssd->dirty_col_max;
+  uint8_t p0 = ssd->dirty_page_min, p1 = ssd->dirty_page_max;
+  if (c1 >= ssd->width) c1 = ssd->width - 1;
+  if (p1 >= ssd->pages) p1 = ssd->pages - 1;
+  ssd1306_clear_dirty(ssd);
+
+  if (ssd->sent_valid && !ssd1306_shrink_window(ssd, &c0, &p0, &c1, &p1))
+    return false; // Nada mudou de fato
+
+  // Janela de endereçamento (Co = 0, sequência de comandos) seguida dos dados.
+  // Cada transação termina com o bit de STOP na última entrada.
+  uint16_t *tx = ssd->tx_buffer;
+  tx[0] = 0x00;
+  tx[1] = SET_COL_ADDR;
+  tx[2] = c0;
+  tx[3] = c1;
+  tx[4] = SET_PAGE_ADDR;
+  tx[5] = p0;
+  tx[6] = p1 | I2C_IC_DATA_CMD_STOP_BITS;
+  tx[7] = 0x40;
+
+  size_t len = SSD1306_TX_HEADER;
+  for (uint16_t x = c0; x <= c1; ++x) {
+    uint16_t base = x * ssd->pages;
+    for (uint8_t p = p0; p <= p1; ++p) {
+      uint8_t byte = ssd->ram_buffer[base + p + 1];
+      tx[len++] = byte;
+      ssd->sent_buffer[base + p] = byte;
+    }
+  }
+  tx[len - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+  // Se a janela cobriu o display inteiro, o espelho passa a ser confiável
+  if (!ssd->sent_valid && c0 == 0 && p0 == 0 && c1 == ssd->width - 1 && p1 == ssd->pages - 1)
+    ssd->sent_valid = true;
+
+  // O callback vem no fim da DMA, com até 16 entradas ainda na FIFO da I2C (~360us a 400kHz):
+  // espera o STOP da transação anterior em vez de recusar o envio até a próxima chamada
+  i2c_hw_t *hw = i2c_get_hw(ssd->i2c_port);
+  while (!ssd1306_i2c_idle(hw))
+    tight_loop_contents();
+  hw->enable = 0;
+  hw->tar = ssd->address;
+  hw->enable = 1;
+  (void)hw->clr_tx_abrt; // Descarta um abort pendente de uma transação anterior
+
+  ssd->busy = true;
+  ssd->bytes_sent += len;
+  trace_log(TRACE_DISPLAY_INICIO, len);
+  dma_channel_transfer_from_buffer_now(ssd->dma_chan, tx, len);
+  return true;
+}
+
+// Versão bloqueante: inicia o envio e aguarda o término
 void ssd1306_send_data(ssd1306_t *ssd) {
-  ssd1306_command(ssd, SET_COL_ADDR);
-  ssd1306_command(ssd, 0);
-  ssd1306_command(ssd, ssd->width - 1);
-  ssd1306_command(ssd, SET_PAGE_ADDR);
-  ssd1306_command(ssd, 0);
-  ssd1306_command(ssd, ssd->pages - 1);
-  i2c_write_blocking(
-    ssd->i2c_port,
-    ssd->address,
-    ssd->ram_buffer,
-    ssd->bufsize,
-    false
-  );
+  ssd1306_wait(ssd);
+  if (ssd1306_send_data_async(ssd))
+    ssd1306_wait(ssd);
 }
 
 void ssd1306_pixel(ssd1306_t *ssd, uint8_t x, uint8_t y, bool value) {
@@ -75,16 +276,95 @@ void ssd1306_pixel(ssd1306_t *ssd, uint8_t x, uint8_t y, bool value) {
     ssd->ram_buffer[index] |= (1 << pixel);
   else
     ssd->ram_buffer[index] &= ~(1 << pixel);
+  ssd1306_mark_dirty(ssd, x, y >> 3, x, y >> 3);
 }
 
-/*
-void ssd1306_fill(ssd1306_t *ssd, bool value) {
-  uint8_t byte = value ? 0xFF : 0x00;
-  for (uint8_t i = 1; i < ssd->bufsize; ++i)
-    ssd->ram_buffer[i] = byte;
-}*/
+// Primitivas otimizadas: como o buffer é organizado por coluna (8 páginas de 1 byte cada),
+// uma coluna vertical é contígua na memória e pode ser escrita byte a byte com máscaras.
+
+// Aplica value aos bits de mask no byte indicado
+static inline void ssd1306_write_mask(uint8_t *byte, uint8_t mask, bool value) {
+  if (value)
+    *byte |= mask;
+  else
+    *byte &= ~mask;
+}
 
 void ssd1306_fill(ssd1306_t *ssd, bool value) {
+  memset(&ssd->ram_buffer[1], value ? 0xFF : 0x00, ssd->bufsize - 1);
+  ssd1306_mark_dirty(ssd, 0, 0, ssd->width - 1, ssd->pages - 1);
+}
+
+void ssd1306_vline(ssd1306_t *ssd, uint8_t x, uint8_t y0, uint8_t y1, bool value) {
+  if (x >= ssd->width || y0 > y1 || y0 >= ssd->height)
+    return;
+  if (y1 >= ssd->height)
+    y1 = ssd->height - 1;
+
+  uint8_t p0 = y0 >> 3, p1 = y1 >> 3;
+  uint8_t first = 0xFF << (y0 & 0b111);       // Bits de y0 até o fim da página
+  uint8_t last = 0xFF >> (7 - (y1 & 0b111));  // Bits do início da página até y1
+  uint8_t *col = &ssd->ram_buffer[x * ssd->pages + 1];
+
+  if (p0 == p1) {
+    ssd1306_write_mask(&col[p0], first & last, value);
+  } else {
+    ssd1306_write_mask(&col[p0], first, value);
+    if (p1 - p0 > 1)
+      memset(&col[p0 + 1], value ? 0xFF : 0x00, p1 - p0 - 1);
+    ssd1306_write_mask(&col[p1], last, value);
+  }
+  ssd1306_mark_dirty(ssd, x, p0, x, p1);
+}
+
+// A linha horizontal tem um bit por coluna na mesma página: o passo entre bytes é pages. Com o
+// buffer em colunas (endereçamento vertical), os bytes de uma linha não são contíguos e não há
+// escrita em palavras de 32 bits: só um bit, com a máscara pronta, a cada coluna
+void ssd1306_hline(ssd1306_t *ssd, uint8_t x0, uint8_t x1, uint8_t y, bool value) {
+  if (x0 > x1 || x0 >= ssd->width || y >= ssd->height)
+    return;
+  if (x1 >= ssd->width)
+    x1 = ssd->width - 1;
+
+  uint8_t page = y >> 3;
+  uint8_t bit = 1 << (y & 0b111);
+  uint8_t *byte = &ssd->ram_buffer[x0 * ssd->pages + page + 1];
+  uint8_t count = x1 - x0 + 1;
+  if (value) {
+    while (count--) {
+      *byte |= bit;
+      byte += ssd->pages;
+    }
+  } else {
+    bit = ~bit;
+    while (count--) {
+      *byte &= bit;
+      byte += ssd->pages;
+    }
+  }
+  ssd1306_mark_dirty(ssd, x0, page, x1, page);
+}
+
+void ssd1306_rect(ssd1306_t *ssd, uint8_t top, uint8_t left, uint8_t width, uint8_t height, bool value, bool fill) {
+  if (width == 0 || height == 0)
+    return;
+  uint8_t right = left + width - 1;
+  uint8_t bottom = top + height - 1;
+
+  if (fill) {
+    // Com preenchimento, borda e interior têm o mesmo valor: cada coluna é uma vline
+    for (uint16_t x = left; x <= right; ++x)
+      ssd1306_vline(ssd, x, top, bottom, value);
+    return;
+  }
+  ssd1306_hline(ssd, left, right, top, value);
+  ssd1306_hline(ssd, left, right, bottom, value);
+  ssd1306_vline(ssd, left, top, bottom, value);
+  ssd1306_vline(ssd, right, top, bottom, value);
+}
+
+// Versões de referência, pixel a pixel, mantidas para conferência das primitivas otimizadas
+void ssd1306_fill_ref(ssd1306_t *ssd, bool value) {
     // Itera por todas as posições do display
     for (uint8_t y = 0; y < ssd->height; ++y) {
         for (uint8_t x = 0; x < ssd->width; ++x) {
@@ -93,9 +373,7 @@ void ssd1306_fill(ssd1306_t *ssd, bool value) {
     }
 }
 
-
-
-void ssd1306_rect(ssd1306_t *ssd, uint8_t top, uint8_t left, uint8_t width, uint8_t height, bool value, bool fill) {
+void ssd1306_rect_ref(ssd1306_t *ssd, uint8_t top, uint8_t left, uint8_t width, uint8_t height, bool value, bool fill) {
   for (uint8_t x = left; x < left + width; ++x) {
     ssd1306_pixel(ssd, x, top, value);
     ssd1306_pixel(ssd, x, top + height - 1, value);
@@ -114,6 +392,16 @@ void ssd1306_rect(ssd1306_t *ssd, uint8_t top, uint8_t left, uint8_t width, uint
   }
 }
 
+void ssd1306_hline_ref(ssd1306_t *ssd, uint8_t x0, uint8_t x1, uint8_t y, bool value) {
+  for (uint8_t x = x0; x <= x1; ++x)
+    ssd1306_pixel(ssd, x, y, value);
+}
+
+void ssd1306_vline_ref(ssd1306_t *ssd, uint8_t x, uint8_t y0, uint8_t y1, bool value) {
+  for (uint8_t y = y0; y <= y1; ++y)
+    ssd1306_pixel(ssd, x, y, value);
+}
+
 void ssd1306_line(ssd1306_t *ssd, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, bool value) {
     int dx = abs(x1 - x0);
     int dy = abs(y1 - y0);
@@ -142,22 +430,69 @@ void ssd1306_line(ssd1306_t *ssd, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1
     }
 }
 
+// Função para desenhar um caractere. A fonte é organizada por coluna (1 byte = 8 pixels
+// verticais), igual às páginas do display: cada coluna do glifo é deslocada para a posição
+// y e combinada com no máximo dois bytes do buffer.
+void ssd1306_draw_char(ssd1306_t *ssd, char c, uint8_t x, uint8_t y, bool inverse)
+{
+  if (x >= ssd->width || y >= ssd->height)
+    return;
 
-void ssd1306_hline(ssd1306_t *ssd, uint8_t x0, uint8_t x1, uint8_t y, bool value) {
-  for (uint8_t x = x0; x <= x1; ++x)
-    ssd1306_pixel(ssd, x, y, value);
+  const uint8_t *glyph = &font[font_index[(uint8_t)c] * 8];
+  uint8_t invert = inverse ? 0xFF : 0x00;
+  uint8_t page = y >> 3;
+  uint8_t shift = y & 0b111;
+  uint8_t mask_lo = 0xFF << shift;         // Bits ocupados na página de cima
+  uint8_t mask_hi = ~mask_lo;              // Bits ocupados na página de baixo (se shift > 0)
+  bool two_pages = shift && (page + 1 < ssd->pages);
+  uint8_t columns = (ssd->width - x < 8) ? ssd->width - x : 8;
+  uint8_t *byte = &ssd->ram_buffer[x * ssd->pages + page + 1];
+
+  for (uint8_t i = 0; i < columns; ++i) {
+    uint8_t line = glyph[i] ^ invert;
+    byte[0] = (byte[0] & ~mask_lo) | (uint8_t)(line << shift);
+    if (two_pages)
+      byte[1] = (byte[1] & ~mask_hi) | (uint8_t)(line >> (8 - shift));
+    byte += ssd->pages;
+  }
+  ssd1306_mark_dirty(ssd, x, page, x + columns - 1, two_pages ? page + 1 : page);
 }
 
-void ssd1306_vline(ssd1306_t *ssd, uint8_t x, uint8_t y0, uint8_t y1, bool value) {
-  for (uint8_t y = y0; y <= y1; ++y)
-    ssd1306_pixel(ssd, x, y, value);
+// Função para desenhar uma string
+void ssd1306_draw_string(ssd1306_t *ssd, const char *str, uint8_t x, uint8_t y, bool inverse)
+{
+  while (*str)
+  {
+    ssd1306_draw_char(ssd, *str++, x, y, inverse);
+    x += 8;
+    if (x + 8 >= ssd->width)
+    {
+      x = 0;
+      y += 8;
+    }
+    if (y + 8 >= ssd->height)
+    {
+      break;
+    }
+  }
 }
 
-// Função para desenhar um caractere
-void ssd1306_draw_char(ssd1306_t *ssd, char c, uint8_t x, uint8_t y, bool inverse)
+// Copia o frame atual para uma camada (SSD1306_BUFFER_SIZE bytes)
+void ssd1306_layer_capture(ssd1306_t *ssd, uint8_t *layer) {
+  memcpy(layer, &ssd->ram_buffer[1], ssd->bufsize - 1);
+}
+
+// Restaura uma camada como frame atual. O envio compara com o que já está no display,
+// então apenas o que difere da camada anterior vai para o barramento.
+void ssd1306_layer_apply(ssd1306_t *ssd, const uint8_t *layer) {
+  memcpy(&ssd->ram_buffer[1], layer, ssd->bufsize - 1);
+  ssd1306_mark_dirty(ssd, 0, 0, ssd->width - 1, ssd->pages - 1);
+}
+
+// Versão de referência do ssd1306_draw_char, pixel a pixel
+void ssd1306_draw_char_ref(ssd1306_t *ssd, char c, uint8_t x, uint8_t y, bool inverse)
 {
   uint16_t index = 0;
-  char ver=c;
   if (c >= 'A' && c <= 'Z')
   {
     index = (c - 'A' + 11) * 8; // Para letras maiúsculas
@@ -217,22 +552,3 @@ void ssd1306_draw_char(ssd1306_t *ssd, char c, uint8_t x, uint8_t y, bool invers
   }
   
 }
-
-// Função para desenhar uma string
-void ssd1306_draw_string(ssd1306_t *ssd, const char *str, uint8_t x, uint8_t y, bool inverse)
-{
-  while (*str)
-  {
-    ssd1306_draw_char(ssd, *str++, x, y, inverse);
-    x += 8;
-    if (x + 8 >= ssd->width)
-    {
-      x = 0;
-      y += 8;
-    }
-    if (y + 8 >= ssd->height)
-    {
-      break;
-    }
-  }
-}
\ No newline at end of file
@@ -4,6 +4,10 @@
 
 #define WIDTH 128
 #define HEIGHT 64
+// Tamanho de um frame sem o byte de controle (128 colunas x 8 páginas)
+#define SSD1306_BUFFER_SIZE (WIDTH * HEIGHT / 8)
+// Cabeçalho do front buffer: comando da janela (7 entradas) + byte de controle de dados
+#define SSD1306_TX_HEADER 8
 
 typedef enum {
   SET_CONTRAST = 0x81,
@@ -25,6 +29,9 @@ typedef enum {
   SET_CHARGE_PUMP = 0x8D
 } ssd1306_command_t;
 
+// Callback chamado (em contexto de interrupção) quando um envio assíncrono termina
+typedef void (*ssd1306_flush_callback_t)(void *ctx);
+
 typedef struct {
   uint8_t width, height, pages, address;
   i2c_inst_t *i2c_port;
@@ -32,12 +39,38 @@ typedef struct {
   uint8_t *ram_buffer;
   size_t bufsize;
   uint8_t port_buffer[2];
+  // Região (colunas/páginas) alterada desde o último envio ao display
+  uint8_t dirty_col_min, dirty_col_max;
+  uint8_t dirty_page_min, dirty_page_max;
+  uint8_t *sent_buffer; // Cópia do que já está na GDDRAM do display
+  bool sent_valid;      // Falso enquanto o conteúdo do display é desconhecido
+  uint16_t *tx_buffer;  // Front buffer: janela + dados no formato do IC_DATA_CMD, lido pela DMA
+  int dma_chan;
+  volatile bool busy;   // Verdadeiro enquanto a DMA alimenta a FIFO da I2C
+  ssd1306_flush_callback_t flush_callback;
+  void *flush_ctx;
+  uint32_t bytes_sent;  // Total de entradas entregues à I2C (comandos e dados), para medições
 } ssd1306_t;
 
+// Buffers de um display WIDTH x HEIGHT, para alocação estática
+typedef struct {
+  uint8_t ram[SSD1306_BUFFER_SIZE + 1];            // Byte de controle + frame buffer
+  uint8_t sent[SSD1306_BUFFER_SIZE];
+  uint16_t tx[SSD1306_TX_HEADER + SSD1306_BUFFER_SIZE];
+} ssd1306_buffers_t;
+
 void ssd1306_init(ssd1306_t *ssd, uint8_t width, uint8_t height, bool external_vcc, uint8_t address, i2c_inst_t *i2c);
+void ssd1306_init_static(ssd1306_t *ssd, bool external_vcc, uint8_t address, i2c_inst_t *i2c, ssd1306_buffers_t *buffers);
 void ssd1306_config(ssd1306_t *ssd);
 void ssd1306_command(ssd1306_t *ssd, uint8_t command);
 void ssd1306_send_data(ssd1306_t *ssd);
+bool ssd1306_send_data_async(ssd1306_t *ssd);
+void ssd1306_set_flush_callback(ssd1306_t *ssd, ssd1306_flush_callback_t callback, void *ctx);
+bool ssd1306_busy(ssd1306_t *ssd);
+void ssd1306_wait(ssd1306_t *ssd);
+void ssd1306_invalidate(ssd1306_t *ssd);
+void ssd1306_contrast(ssd1306_t *ssd, uint8_t contrast);
+void ssd1306_power(ssd1306_t *ssd, bool on);
 
 void ssd1306_pixel(ssd1306_t *ssd, uint8_t x, uint8_t y, bool value);
 void ssd1306_fill(ssd1306_t *ssd, bool value);
@@ -46,4 +79,15 @@ void ssd1306_line(ssd1306_t *ssd, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1
 void ssd1306_hline(ssd1306_t *ssd, uint8_t x0, uint8_t x1, uint8_t y, bool value);
 void ssd1306_vline(ssd1306_t *ssd, uint8_t x, uint8_t y0, uint8_t y1, bool value);
 void ssd1306_draw_char(ssd1306_t *ssd, char c, uint8_t x, uint8_t y, bool inverse);
-void ssd1306_draw_string(ssd1306_t *ssd, const char *str, uint8_t x, uint8_t y, bool inverse);
\ No newline at end of file
+void ssd1306_draw_string(ssd1306_t *ssd, const char *str, uint8_t x, uint8_t y, bool inverse);
+
+// Camadas retidas: frames pré-renderizados copiados de/para o buffer do display
+void ssd1306_layer_capture(ssd1306_t *ssd, uint8_t *layer);
+void ssd1306_layer_apply(ssd1306_t *ssd, const uint8_t *layer);
+
+// Versões de referência (pixel a pixel) das primitivas otimizadas
+void ssd1306_fill_ref(ssd1306_t *ssd, bool value);
+void ssd1306_rect_ref(ssd1306_t *ssd, uint8_t top, uint8_t left, uint8_t width, uint8_t height, bool value, bool fill);
+void ssd1306_hline_ref(ssd1306_t *ssd, uint8_t x0, uint8_t x1, uint8_t y, bool value);
+void ssd1306_vline_ref(ssd1306_t *ssd, uint8_t x, uint8_t y0, uint8_t y1, bool value);
+void ssd1306_draw_char_ref(ssd1306_t *ssd, char c, uint8_t x, uint8_t y, bool inverse);
\ No newline at end of file
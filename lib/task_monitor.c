@@ -0,0 +1,143 @@
+#include "task_monitor.h"
+#include <stdio.h>
+#include "timers.h"
+
+// Tamanho conhecido da stack de cada task registrada
+typedef struct {
+    TaskHandle_t task;
+    uint32_t stack_words;
+} task_monitor_entry_t;
+
+// Contadores de cada task no relatório anterior, para calcular as diferenças
+typedef struct {
+    TaskHandle_t task;
+    configRUN_TIME_COUNTER_TYPE runtime;
+    uint32_t switches;
+} task_monitor_prev_t;
+
+static task_monitor_entry_t entries[TASK_MONITOR_MAX_TASKS];
+static uint num_entries = 0;
+#if configGENERATE_RUN_TIME_STATS
+static task_monitor_prev_t prev[TASK_MONITOR_MAX_TASKS];
+static configRUN_TIME_COUNTER_TYPE prev_total = 0;
+#endif
+static uint32_t reports = 0;
+static uint32_t report_period_ms;
+
+// O relatório fica em buffers estáticos para não pesar na stack nem no heap
+static TaskStatus_t status[TASK_MONITOR_MAX_TASKS];
+static StackType_t reporter_stack[TASK_MONITOR_STACK];
+static StaticTask_t reporter_tcb;
+
+void task_monitor_register(TaskHandle_t task, uint32_t stack_words){
+    configASSERT(num_entries < TASK_MONITOR_MAX_TASKS);
+    entries[num_entries].task = task;
+    entries[num_entries].stack_words = stack_words;
+    num_entries++;
+}
+
+void task_monitor_switched_in(void){
+    // Executada dentro da troca de contexto: só incrementa o contador da task atual
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    uintptr_t trocas = (uintptr_t)pvTaskGetThreadLocalStoragePointer(task, TASK_MONITOR_TLS_SWITCHES);
+    vTaskSetThreadLocalStoragePointer(task, TASK_MONITOR_TLS_SWITCHES, (void *)(trocas + 1));
+}
+
+static void vTaskMonitorTask(void *param){
+    while(true){
+        vTaskDelay(pdMS_TO_TICKS(report_period_ms));
+        task_monitor_report();
+    }
+}
+
+void task_monitor_init(uint32_t report_ms){
+    report_period_ms = report_ms;
+    xTaskCreateStatic(vTaskMonitorTask, "Task Monitor", TASK_MONITOR_STACK, NULL, tskIDLE_PRIORITY, reporter_stack, &reporter_tcb);
+}
+
+// Tamanho da stack da task, se conhecido (0 caso contrário)
+static uint32_t task_monitor_stack_words(TaskHandle_t task){
+    for(uint i = 0; i < num_entries; i++){
+        if(entries[i].task == task){
+            return entries[i].stack_words;
+        }
+    }
+    if(task == xTimerGetTimerDaemonTaskHandle()){
+        return configTIMER_TASK_STACK_DEPTH;
+    }
+    if(task == xTaskGetCurrentTaskHandle()){
+        return TASK_MONITOR_STACK;
+    }
+    return 0;
+}
+
+#if configGENERATE_RUN_TIME_STATS
+// Substitui os contadores guardados da task e retorna os anteriores (zerados na primeira vez)
+static task_monitor_prev_t task_monitor_swap(TaskHandle_t task, configRUN_TIME_COUNTER_TYPE runtime, uint32_t switches){
+    task_monitor_prev_t anterior = {task, 0, 0};
+    task_monitor_prev_t *livre = NULL;
+    for(uint i = 0; i < TASK_MONITOR_MAX_TASKS; i++){
+        if(prev[i].task == task){
+            anterior = prev[i];
+            livre = &prev[i];
+            break;
+        }
+        if(!livre && !prev[i].task){
+            livre = &prev[i];
+        }
+    }
+    if(livre){
+        livre->task = task;
+        livre->runtime = runtime;
+        livre->switches = switches;
+    }
+    return anterior;
+}
+#endif
+
+void task_monitor_report(void){
+    configRUN_TIME_COUNTER_TYPE total = 0;
+    UBaseType_t num_tasks = uxTaskGetSystemState(status, TASK_MONITOR_MAX_TASKS, &total);
+
+    reports++;
+    printf("(STATS) relatorio %lu, %lu s, %lu tasks\n", (unsigned long)reports,
+           (unsigned long)(time_us_64() / 1000000), (unsigned long)num_tasks);
+
+#if configGENERATE_RUN_TIME_STATS
+    // O contador é o tempo de execução; cada core contribui com esse tempo para as tasks
+    uint64_t intervalo = (total - prev_total) * configNUMBER_OF_CORES;
+    prev_total = total;
+#endif
+
+    for(UBaseType_t i = 0; i < num_tasks; i++){
+        TaskStatus_t *t = &status[i];
+        printf("(STATS) %-20s", t->pcTaskName);
+
+#if configGENERATE_RUN_TIME_STATS
+        uint32_t trocas = (uintptr_t)pvTaskGetThreadLocalStoragePointer(t->xHandle, TASK_MONITOR_TLS_SWITCHES);
+        task_monitor_prev_t anterior = task_monitor_swap(t->xHandle, t->ulRunTimeCounter, trocas);
+        uint32_t cpu_permil = intervalo ? (t->ulRunTimeCounter - anterior.runtime) * 1000 / intervalo : 0;
+        printf(" cpu %3lu.%lu%% trocas %6lu", (unsigned long)(cpu_permil / 10), (unsigned long)(cpu_permil % 10),
+               (unsigned long)(trocas - anterior.switches));
+#endif
+
+        // O high water mark é a menor folga já vista desde a criação da task
+        uint32_t livre = t->usStackHighWaterMark;
+        uint32_t tamanho = task_monitor_stack_words(t->xHandle);
+        if(tamanho){
+            uint32_t usado = tamanho - livre;
+            uint32_t margem = usado * TASK_MONITOR_MARGIN_PCT / 100;
+            if(margem < TASK_MONITOR_MARGIN_MIN){
+                margem = TASK_MONITOR_MARGIN_MIN;
+            }
+            printf(" stack %4lu/%4lu, sugerido %4lu\n", (unsigned long)usado, (unsigned long)tamanho,
+                   (unsigned long)(usado + margem));
+        }
+        else{
+            printf(" stack livre %4lu\n", (unsigned long)livre);
+        }
+    }
+#if configSUPPORT_DYNAMIC_ALLOCATION
+    printf("(STATS) heap livre %u bytes, minimo %u bytes\n", (unsigned)xPortGetFreeHeapSize(), (unsigned)xPortGetMinimumEverFreeHeapSize());
+#endif
+}
@@ -0,0 +1,32 @@
+#ifndef TASK_MONITOR_H
+#define TASK_MONITOR_H
+
+#include "pico/stdlib.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+// Quantidade máxima de tasks acompanhadas (as registradas e as do kernel)
+#define TASK_MONITOR_MAX_TASKS 12
+// Período padrão do relatório (em ms)
+#define TASK_MONITOR_REPORT_MS 60000
+// Stack da task do relatório (em palavras; o printf é o maior consumidor)
+#ifndef TASK_MONITOR_STACK
+#define TASK_MONITOR_STACK 512
+#endif
+// Margem somada ao pico de uso para sugerir o tamanho da stack (em % do pico, mínimo em palavras)
+#define TASK_MONITOR_MARGIN_PCT 25
+#define TASK_MONITOR_MARGIN_MIN 32
+// Ponteiro de thread local storage usado como contador de trocas de contexto de cada task
+#define TASK_MONITOR_TLS_SWITCHES 0
+
+// Registra uma task e o tamanho da sua stack (em palavras)
+void task_monitor_register(TaskHandle_t task, uint32_t stack_words);
+// Cria a task do relatório, na menor prioridade, que imprime a cada report_ms
+void task_monitor_init(uint32_t report_ms);
+// Para cada task: uso de CPU e trocas de contexto desde o último relatório (com as estatísticas
+// de execução ativas) e pico de uso da stack, com o tamanho sugerido para as de tamanho conhecido
+void task_monitor_report(void);
+// Chamada pelo traceTASK_SWITCHED_IN: conta as trocas de contexto da task que entra
+void task_monitor_switched_in(void);
+
+#endif
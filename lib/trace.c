@@ -0,0 +1,64 @@
+#include "trace.h"
+
+#ifdef SEMAFORO_TRACE
+
+#include <stdio.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+trace_record_t trace_ring[2][TRACE_RING_SIZE];
+uint32_t trace_head[2];
+volatile bool trace_enabled = false;
+
+// Próximo número de task de cada core. O bit 15 separa os cores, então cada core
+// numera as tasks que vê pela primeira vez sem disputar com o outro.
+static uint16_t next_task_number[2] = {1, 0x8001};
+
+static TaskStatus_t dump_status[16];
+
+void trace_task_switched_in(void){
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    UBaseType_t numero = uxTaskGetTaskNumber(task);
+    if(!numero){
+        // Primeira vez que a task roda: recebe um número, que identifica a task no dump
+        numero = next_task_number[get_core_num()]++;
+        vTaskSetTaskNumber(task, numero);
+    }
+    trace_log(TRACE_TASK_IN, numero);
+}
+
+void trace_init(void){
+    trace_enabled = true;
+}
+
+// Formato (uma linha por item, lido pelo tools/trace_decode.py):
+//   TRACE BEGIN
+//   TASK <número> <nome>
+//   REC <core> <tempo_us> <tipo> <arg>   (hexadecimal)
+//   TRACE END
+void trace_dump(void){
+    // Pausa o registro para que o anel não mude durante o envio
+    trace_enabled = false;
+
+    printf("TRACE BEGIN\n");
+    UBaseType_t num_tasks = uxTaskGetSystemState(dump_status, 16, NULL);
+    for(UBaseType_t i = 0; i < num_tasks; i++){
+        UBaseType_t numero = uxTaskGetTaskNumber(dump_status[i].xHandle);
+        if(numero){
+            printf("TASK %lu %s\n", (unsigned long)numero, dump_status[i].pcTaskName);
+        }
+    }
+    for(uint core = 0; core < 2; core++){
+        uint32_t head = trace_head[core];
+        uint32_t inicio = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+        for(uint32_t i = inicio; i < head; i++){
+            trace_record_t *r = &trace_ring[core][i & (TRACE_RING_SIZE - 1)];
+            printf("REC %u %08lx %x %x\n", core, (unsigned long)r->tempo_us, r->tipo, r->arg);
+        }
+    }
+    printf("TRACE END\n");
+
+    trace_enabled = true;
+}
+
+#endif
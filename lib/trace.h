@@ -0,0 +1,67 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+// Registros por core (potência de 2): com 8 bytes por registro, 4 KB por core
+#define TRACE_RING_SIZE 512
+
+// Tipos de evento (o decodificador em tools/trace_decode.py usa os mesmos valores)
+typedef enum {
+    TRACE_TASK_IN = 1,      // arg: número da task que entrou no core
+    TRACE_FASE,             // arg: estado do semáforo no início da fase
+    TRACE_MODO,             // arg: 1 noturno, 0 normal
+    TRACE_BOTAO_BORDA,      // arg: nível do pino
+    TRACE_DISPLAY_INICIO,   // arg: quantidade de palavras enviadas pela DMA
+    TRACE_DISPLAY_FIM,
+    TRACE_MATRIZ_DMA_FIM,
+    TRACE_MATRIZ_LATCH,
+    TRACE_GRUPO,            // arg: grupo de sinal (bits 15-8) e novo signal_state_t (bits 7-0)
+    TRACE_PEDESTRE,         // arg: 0 na chamada; na abertura da travessia, a espera em ms
+} trace_event_t;
+
+// Registro binário de um evento
+typedef struct {
+    uint32_t tempo_us;  // time_us_32(): volta a zero a cada ~71 min, o decodificador desfaz a volta
+    uint16_t tipo;
+    uint16_t arg;
+} trace_record_t;
+
+#ifdef SEMAFORO_TRACE
+
+// Um anel por core: cada core só escreve no seu, então não há trava entre os cores
+extern trace_record_t trace_ring[2][TRACE_RING_SIZE];
+extern uint32_t trace_head[2];
+extern volatile bool trace_enabled;
+
+// Registra um evento: poucas instruções, com as interrupções do core bloqueadas só para reservar a posição
+static inline void trace_log(trace_event_t tipo, uint16_t arg){
+    if(!trace_enabled){
+        return;
+    }
+    uint core = get_core_num();
+    uint32_t irq = save_and_disable_interrupts();
+    uint32_t i = trace_head[core]++;
+    restore_interrupts(irq);
+    trace_record_t *r = &trace_ring[core][i & (TRACE_RING_SIZE - 1)];
+    r->tempo_us = time_us_32();
+    r->tipo = tipo;
+    r->arg = arg;
+}
+
+// Ativa o trace (o dump é pedido pelo comando de trace do protocolo, em protocol.h)
+void trace_init(void);
+// Envia os anéis em hexadecimal pelo stdio, com a tabela de nomes das tasks
+void trace_dump(void);
+// Chamada pelo traceTASK_SWITCHED_IN
+void trace_task_switched_in(void);
+
+#else
+
+// Sem SEMAFORO_TRACE os pontos de trace não geram código
+static inline void trace_log(trace_event_t tipo, uint16_t arg){}
+
+#endif
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef SIM_FREERTOS_CONFIG_H
+#define SIM_FREERTOS_CONFIG_H
+
+/* Configuração do simulador: a mesma do firmware (lib/FreeRTOSConfig.h), com os ajustes
+ * exigidos pela porta POSIX do FreeRTOS (um core, threads do Linux como tasks). */
+#include "../lib/FreeRTOSConfig.h"
+
+/* A porta POSIX é single-core */
+#undef configNUMBER_OF_CORES
+#undef configUSE_CORE_AFFINITY
+#undef configTIMER_SERVICE_TASK_CORE_AFFINITY
+#undef configTICK_CORE
+#undef configRUN_MULTIPLE_PRIORITIES
+#undef configUSE_PASSIVE_IDLE_HOOK
+#undef configSUPPORT_PICO_SYNC_INTEROP
+#undef configSUPPORT_PICO_TIME_INTEROP
+#define configNUMBER_OF_CORES                   1
+#define configUSE_CORE_AFFINITY                 0
+
+/* Cada task é uma pthread, que exige no mínimo PTHREAD_STACK_MIN (16 KB) de stack.
+ * As stacks das tasks do firmware são redefinidas aqui (ver SemaforoMultithread.c). */
+#undef configMINIMAL_STACK_SIZE
+#undef configTIMER_TASK_STACK_DEPTH
+#define configMINIMAL_STACK_SIZE                ( configSTACK_DEPTH_TYPE ) 4096
+#define configTIMER_TASK_STACK_DEPTH            configMINIMAL_STACK_SIZE
+#define STACK_TIMER_SEMAFORO                    configMINIMAL_STACK_SIZE
+#define STACK_DISPLAY                           configMINIMAL_STACK_SIZE
+#define STACK_MATRIX                            configMINIMAL_STACK_SIZE
+#define TASK_MONITOR_STACK                      configMINIMAL_STACK_SIZE
+#define PROTOCOL_STACK                          configMINIMAL_STACK_SIZE
+#define LOG_STACK                               configMINIMAL_STACK_SIZE
+#define BENCH_STACK                             configMINIMAL_STACK_SIZE
+#define SIM_STACK                               configMINIMAL_STACK_SIZE
+
+/* As tasks rodam nas stacks das pthreads, não nos buffers do FreeRTOS: sem conferência de estouro */
+#undef configCHECK_FOR_STACK_OVERFLOW
+#define configCHECK_FOR_STACK_OVERFLOW          0
+
+/* Tempo virtual: o tickless idle da task Idle é desviado para sim_idle(), que adianta o
+ * tick até o próximo prazo em vez de dormir (ver sim_hw.c). Os ganchos do modo de baixo
+ * consumo continuam sendo chamados em volta do salto. */
+#undef configUSE_TICKLESS_IDLE
+#undef configEXPECTED_IDLE_TIME_BEFORE_SLEEP
+#undef configSYSTICK_CLOCK_HZ
+#define configUSE_TICKLESS_IDLE                 1
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP   2
+void sim_idle(unsigned long ticks);
+#define portSUPPRESS_TICKS_AND_SLEEP(x)         sim_idle(x)
+
+#endif /* SIM_FREERTOS_CONFIG_H */
@@ -0,0 +1,12 @@
+#pragma once
+// Versão simulada do cabeçalho gerado a partir de lib/buzzer_tone.pio
+#include "sim_hw.h"
+
+#define BUZZER_TONE_PIO_FREQ 1000000
+
+static const pio_program_t buzzer_tone_program = {NULL, 14, -1};
+
+static inline void buzzer_tone_program_init(PIO pio, uint sm, uint offset, uint pin) {
+    pio_gpio_init(pio, pin);
+    pio_sm_init(pio, sm, offset, NULL);
+}
@@ -0,0 +1,161 @@
+#ifndef SIM_HW_H
+#define SIM_HW_H
+
+// Camada de hardware simulada: substitui os cabeçalhos do pico-sdk usados pelo firmware.
+// As saídas (PWM, bytes do SSD1306, palavras da WS2812 e descritores dos buzzers) são
+// gravadas no log do simulador com o tempo virtual.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef unsigned int uint;
+
+// Tempo (virtual: derivado do tick do FreeRTOS) ===============================================
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+typedef int32_t alarm_id_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void *user_data);
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past);
+static inline void busy_wait_us(uint64_t us) { (void)us; }
+
+// Sistema ======================================================================================
+#define PICO_OK 0
+#define PICO_ERROR_TIMEOUT (-1)
+bool stdio_init_all(void);
+int getchar_timeout_us(uint32_t timeout_us);
+void stdio_set_chars_available_callback(void (*fn)(void *), void *param);
+int stdio_put_string(const char *s, int len, bool newline, bool cr_translation);
+void panic_unsupported(void);
+static inline void tight_loop_contents(void) {}
+static inline uint get_core_num(void) { return 0; }
+static inline uint __get_current_exception(void) { return 0; }
+static inline uint32_t save_and_disable_interrupts(void) { return 0; }
+static inline void restore_interrupts(uint32_t status) { (void)status; }
+
+// GPIO =========================================================================================
+enum gpio_function { GPIO_FUNC_I2C = 3, GPIO_FUNC_PWM = 4, GPIO_FUNC_SIO = 5, GPIO_FUNC_PIO0 = 6, GPIO_FUNC_PIO1 = 7 };
+#define GPIO_IN false
+#define GPIO_OUT true
+#define GPIO_IRQ_EDGE_FALL 0x4u
+#define GPIO_IRQ_EDGE_RISE 0x8u
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_set_function(uint gpio, enum gpio_function fn);
+void gpio_pull_up(uint gpio);
+bool gpio_get(uint gpio);
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback);
+
+// PWM ==========================================================================================
+uint pwm_gpio_to_slice_num(uint gpio);
+void pwm_set_clkdiv(uint slice, float div);
+void pwm_set_wrap(uint slice, uint16_t wrap);
+void pwm_set_enabled(uint slice, bool enabled);
+void pwm_set_gpio_level(uint gpio, uint16_t level);
+
+// Clocks =======================================================================================
+enum clock_index { clk_sys = 5 };
+uint32_t clock_get_hz(enum clock_index clk);
+
+// IRQ ==========================================================================================
+#define DMA_IRQ_0 11
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY 0x80
+typedef void (*irq_handler_t)(void);
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority);
+void irq_set_enabled(uint num, bool enabled);
+
+// I2C ==========================================================================================
+typedef struct {
+    volatile uint32_t enable;
+    volatile uint32_t tar;
+    volatile uint32_t data_cmd;
+    volatile uint32_t status;
+    volatile uint32_t clr_tx_abrt;
+} i2c_hw_t;
+typedef struct {
+    i2c_hw_t *hw;
+    uint index;
+} i2c_inst_t;
+extern i2c_inst_t sim_i2c[2];
+#define i2c0 (&sim_i2c[0])
+#define i2c1 (&sim_i2c[1])
+#define I2C_IC_DATA_CMD_STOP_BITS 0x200u
+#define I2C_IC_STATUS_ACTIVITY_BITS 0x1u
+#define I2C_IC_STATUS_TFE_BITS 0x4u
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+static inline i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c) { return i2c->hw; }
+static inline uint i2c_hw_index(i2c_inst_t *i2c) { return i2c->index; }
+static inline uint i2c_get_dreq(i2c_inst_t *i2c, bool is_tx) { return 32 + 2 * i2c->index + !is_tx; }
+
+// PIO ==========================================================================================
+typedef struct {
+    volatile uint32_t txf[4];
+    uint index;
+} pio_hw_t;
+typedef pio_hw_t *PIO;
+extern pio_hw_t sim_pio[2];
+#define pio0 (&sim_pio[0])
+#define pio1 (&sim_pio[1])
+typedef struct { const uint16_t *instructions; uint8_t length; int8_t origin; } pio_program_t;
+typedef struct { uint32_t clkdiv; } pio_sm_config;
+uint pio_add_program(PIO pio, const pio_program_t *program);
+int pio_claim_unused_sm(PIO pio, bool required);
+static inline uint pio_get_dreq(PIO pio, uint sm, bool is_tx) { return pio->index * 8 + sm + (is_tx ? 0 : 4); }
+static inline uint pio_encode_jmp(uint addr) { return addr; }
+void pio_gpio_init(PIO pio, uint pin);
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin, uint count, bool is_out);
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_enable_sm_mask_in_sync(PIO pio, uint32_t mask);
+void pio_sm_clear_fifos(PIO pio, uint sm);
+void pio_sm_restart(PIO pio, uint sm);
+void pio_sm_exec(PIO pio, uint sm, uint instr);
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask);
+static inline void sm_config_set_sideset_pins(pio_sm_config *c, uint pin) {}
+static inline void sm_config_set_set_pins(pio_sm_config *c, uint base, uint count) {}
+static inline void sm_config_set_out_shift(pio_sm_config *c, bool right, bool autopull, uint threshold) {}
+static inline void sm_config_set_fifo_join(pio_sm_config *c, int join) {}
+static inline void sm_config_set_clkdiv(pio_sm_config *c, float div) {}
+#define PIO_FIFO_JOIN_TX 1
+
+// DMA ==========================================================================================
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+typedef struct {
+    enum dma_channel_transfer_size size;
+    bool read_increment;
+    bool write_increment;
+    uint ring_bits;
+    uint dreq;
+} dma_channel_config;
+int dma_claim_unused_channel(bool required);
+dma_channel_config dma_channel_get_default_config(uint channel);
+static inline void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) { c->size = size; }
+static inline void channel_config_set_read_increment(dma_channel_config *c, bool incr) { c->read_increment = incr; }
+static inline void channel_config_set_write_increment(dma_channel_config *c, bool incr) { c->write_increment = incr; }
+static inline void channel_config_set_dreq(dma_channel_config *c, uint dreq) { c->dreq = dreq; }
+static inline void channel_config_set_ring(dma_channel_config *c, bool write, uint size_bits) { c->ring_bits = size_bits; }
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint32_t transfer_count, bool trigger);
+void dma_channel_transfer_from_buffer_now(uint channel, const volatile void *read_addr, uint32_t transfer_count);
+void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger);
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger);
+void dma_channel_set_irq0_enabled(uint channel, bool enabled);
+bool dma_channel_get_irq0_status(uint channel);
+void dma_channel_acknowledge_irq0(uint channel);
+void dma_channel_abort(uint channel);
+
+// Flash ========================================================================================
+// A flash é um vetor em RAM mapeado em XIP_BASE, carregado e salvo no arquivo SIM_FLASH (se definido)
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+#define FLASH_SECTOR_SIZE 4096u
+#define FLASH_PAGE_SIZE 256u
+extern uint8_t sim_flash[PICO_FLASH_SIZE_BYTES];
+#define XIP_BASE ((uintptr_t)sim_flash)
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms);
+
+#endif
@@ -0,0 +1,15 @@
+#pragma once
+// Versão simulada do cabeçalho gerado a partir de lib/ws2812.pio
+#include "sim_hw.h"
+
+#define ws2812_T1 3
+#define ws2812_T2 3
+#define ws2812_T3 4
+
+static const pio_program_t ws2812_program = {NULL, 4, -1};
+
+static inline void ws2812_program_init(PIO pio, uint sm, uint offset, uint pin, float freq, bool rgbw) {
+    pio_gpio_init(pio, pin);
+    pio_sm_init(pio, sm, offset, NULL);
+    pio_sm_set_enabled(pio, sm, true);
+}
@@ -0,0 +1,556 @@
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include "sim_hw.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+// Duração padrão de um toque no botão (em ms), quando SIM_BOTAO não informa
+#define SIM_TOQUE_MS 100
+#define SIM_GPIOS 30
+#define SIM_DMA_CANAIS 12
+#define SIM_IRQS 32
+#define SIM_IRQ_HANDLERS 4
+
+// Configuração lida das variáveis de ambiente em stdio_init_all
+static FILE *sim_log = NULL;
+static bool sim_virtual = true;
+static uint64_t sim_duracao_ms = 0;
+static const char *sim_botao = NULL;
+static struct timespec sim_inicio_real;
+static uint32_t sim_linhas = 0;
+static StackType_t sim_stack[SIM_STACK];
+static StaticTask_t sim_tcb;
+// Entrada pelo stdin (SIM_STDIN=1), para o cliente do protocolo rodar o simulador num pipe
+static bool sim_stdin = false;
+static void (*sim_chars_callback)(void *) = NULL;
+static void *sim_chars_param = NULL;
+static uint8_t sim_entrada[256];
+static size_t sim_entrada_tamanho = 0;
+static size_t sim_entrada_pos = 0;
+static StackType_t sim_stdin_stack[SIM_STACK];
+static StaticTask_t sim_stdin_tcb;
+
+// Registro das saídas =========================================================================
+
+// Uma linha do log: tempo virtual em us, tipo e os dados. A seção crítica bloqueia o tick da
+// porta POSIX, para que uma troca de contexto não intercale duas linhas.
+static void sim_registra(const char *tipo, const char *fmt, ...){
+    if(!sim_log){
+        return;
+    }
+    va_list args;
+    va_start(args, fmt);
+    taskENTER_CRITICAL();
+    fprintf(sim_log, "%llu,%s,", (unsigned long long)time_us_64(), tipo);
+    vfprintf(sim_log, fmt, args);
+    fputc('\n', sim_log);
+    sim_linhas++;
+    taskEXIT_CRITICAL();
+    va_end(args);
+}
+
+// Registra um bloco de palavras (1, 2 ou 4 bytes cada) em hexadecimal, separadas por espaço
+static void sim_registra_palavras(const char *tipo, uint id_a, uint id_b, const volatile void *dados,
+                                  uint32_t quantidade, enum dma_channel_transfer_size tamanho){
+    if(!sim_log){
+        return;
+    }
+    taskENTER_CRITICAL();
+    fprintf(sim_log, "%llu,%s,%u,%u,", (unsigned long long)time_us_64(), tipo, id_a, id_b);
+    for(uint32_t i = 0; i < quantidade; i++){
+        uint32_t palavra;
+        if(tamanho == DMA_SIZE_8) palavra = ((const volatile uint8_t *)dados)[i];
+        else if(tamanho == DMA_SIZE_16) palavra = ((const volatile uint16_t *)dados)[i] & 0xFF; // só o byte do DATA_CMD
+        else palavra = ((const volatile uint32_t *)dados)[i];
+        fprintf(sim_log, i ? " %0*x" : "%0*x", tamanho == DMA_SIZE_32 ? 8 : 2, (unsigned)palavra);
+    }
+    fputc('\n', sim_log);
+    sim_linhas++;
+    taskEXIT_CRITICAL();
+}
+
+// Tempo virtual =================================================================================
+
+// Derivado do tick do FreeRTOS. Dentro do mesmo tick cada leitura avança 1 us, para manter
+// as medições (latência, trace, estatísticas) monotônicas e com durações não nulas.
+uint64_t time_us_64(void){
+    static TickType_t ultimo_tick = 0;
+    static uint32_t sub_us = 0;
+    TickType_t tick = xTaskGetTickCount();
+    if(tick != ultimo_tick){
+        ultimo_tick = tick;
+        sub_us = 0;
+    }
+    else if(sub_us < 1000000 / configTICK_RATE_HZ - 1){
+        sub_us++;
+    }
+    return (uint64_t)tick * (1000000 / configTICK_RATE_HZ) + sub_us;
+}
+
+uint32_t time_us_32(void){
+    return (uint32_t)time_us_64();
+}
+
+// Chamado pela task Idle no lugar do sono do tickless idle: com o tempo virtual, o tick salta
+// direto para o próximo prazo, e um dia de operação roda no tempo que as tasks levam para
+// processá-lo. Com SIM_TEMPO=real a Idle apenas espera o tick da porta POSIX.
+void sim_idle(unsigned long ticks){
+#ifdef configPRE_SLEEP_PROCESSING
+    uint32_t x = ticks;
+    configPRE_SLEEP_PROCESSING(x);
+#endif
+    if(sim_virtual){
+        vTaskStepTick(ticks);
+    }
+#ifdef configPOST_SLEEP_PROCESSING
+    configPOST_SLEEP_PROCESSING(x);
+#endif
+}
+
+// O atraso do alarme (latch da matriz, < 1 tick) é desprezado: o callback roda na hora
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past){
+    callback(1, user_data);
+    return 1;
+}
+
+// GPIO ==========================================================================================
+
+static bool gpio_nivel[SIM_GPIOS];
+static uint gpio_botao = SIM_GPIOS;
+static gpio_irq_callback_t gpio_callback = NULL;
+
+void gpio_init(uint gpio){
+    gpio_nivel[gpio] = false;
+}
+
+void gpio_set_dir(uint gpio, bool out){}
+
+void gpio_set_function(uint gpio, enum gpio_function fn){}
+
+void gpio_pull_up(uint gpio){
+    gpio_nivel[gpio] = true;
+}
+
+bool gpio_get(uint gpio){
+    return gpio_nivel[gpio];
+}
+
+// O botão simulado é o GPIO que registrou a interrupção
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback){
+    gpio_botao = enabled ? gpio : SIM_GPIOS;
+    gpio_callback = callback;
+}
+
+// Muda o nível do botão e chama o callback da borda, como a interrupção do GPIO faria
+static void sim_botao_nivel(bool nivel){
+    if(gpio_botao >= SIM_GPIOS){
+        return;
+    }
+    gpio_nivel[gpio_botao] = nivel;
+    sim_registra("GPIO", "%u,%u", gpio_botao, nivel);
+    if(gpio_callback){
+        gpio_callback(gpio_botao, nivel ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL);
+    }
+}
+
+// PWM ===========================================================================================
+
+static uint16_t pwm_nivel[SIM_GPIOS];
+static bool pwm_registrado[SIM_GPIOS];
+
+uint pwm_gpio_to_slice_num(uint gpio){
+    return (gpio >> 1) & 7;
+}
+
+void pwm_set_clkdiv(uint slice, float div){}
+
+void pwm_set_wrap(uint slice, uint16_t wrap){}
+
+void pwm_set_enabled(uint slice, bool enabled){}
+
+// Só as mudanças de nível vão para o log
+void pwm_set_gpio_level(uint gpio, uint16_t level){
+    if(pwm_registrado[gpio] && pwm_nivel[gpio] == level){
+        return;
+    }
+    pwm_nivel[gpio] = level;
+    pwm_registrado[gpio] = true;
+    sim_registra("PWM", "%u,%u", gpio, level);
+}
+
+// Clocks e IRQs =================================================================================
+
+uint32_t clock_get_hz(enum clock_index clk){
+    return 125000000;
+}
+
+static irq_handler_t irq_handlers[SIM_IRQS][SIM_IRQ_HANDLERS];
+static bool irq_habilitada[SIM_IRQS];
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority){
+    for(uint i = 0; i < SIM_IRQ_HANDLERS; i++){
+        if(!irq_handlers[num][i]){
+            irq_handlers[num][i] = handler;
+            return;
+        }
+    }
+    panic_unsupported();
+}
+
+void irq_set_enabled(uint num, bool enabled){
+    irq_habilitada[num] = enabled;
+}
+
+static void sim_irq(uint num){
+    if(!irq_habilitada[num]){
+        return;
+    }
+    for(uint i = 0; i < SIM_IRQ_HANDLERS && irq_handlers[num][i]; i++){
+        irq_handlers[num][i]();
+    }
+}
+
+// I2C ===========================================================================================
+
+// A FIFO de transmissão simulada está sempre vazia: os bytes vão direto para o log
+static i2c_hw_t sim_i2c_hw[2] = {{.status = I2C_IC_STATUS_TFE_BITS}, {.status = I2C_IC_STATUS_TFE_BITS}};
+i2c_inst_t sim_i2c[2] = {{&sim_i2c_hw[0], 0}, {&sim_i2c_hw[1], 1}};
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate){
+    return baudrate;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop){
+    sim_registra_palavras("I2C", i2c->index, addr, src, len, DMA_SIZE_8);
+    return len;
+}
+
+// PIO ===========================================================================================
+
+pio_hw_t sim_pio[2] = {{.index = 0}, {.index = 1}};
+static uint pio_sms_usadas[2];
+
+uint pio_add_program(PIO pio, const pio_program_t *program){
+    return 0;
+}
+
+int pio_claim_unused_sm(PIO pio, bool required){
+    if(pio_sms_usadas[pio->index] >= 4){
+        if(required) panic_unsupported();
+        return -1;
+    }
+    return pio_sms_usadas[pio->index]++;
+}
+
+void pio_gpio_init(PIO pio, uint pin){}
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin, uint count, bool is_out){}
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config){}
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled){}
+void pio_sm_clear_fifos(PIO pio, uint sm){}
+void pio_sm_restart(PIO pio, uint sm){}
+void pio_sm_exec(PIO pio, uint sm, uint instr){}
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask){}
+
+// Máquinas de estados que partem juntas (buzzers): máscara 0 significa todas paradas
+void pio_enable_sm_mask_in_sync(PIO pio, uint32_t mask){
+    sim_registra("PIO_SM", "%u,%x", pio->index, (unsigned)mask);
+}
+
+// DMA ===========================================================================================
+
+typedef struct {
+    dma_channel_config config;
+    volatile void *write_addr;
+    const volatile void *read_addr;
+    uint32_t trans_count;
+    bool irq0_enabled;
+    bool irq0_status;
+} sim_dma_t;
+
+static sim_dma_t sim_dma[SIM_DMA_CANAIS];
+static uint sim_dma_usados = 0;
+
+int dma_claim_unused_channel(bool required){
+    if(sim_dma_usados >= SIM_DMA_CANAIS){
+        if(required) panic_unsupported();
+        return -1;
+    }
+    return sim_dma_usados++;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel){
+    return (dma_channel_config){.size = DMA_SIZE_32, .read_increment = true, .write_increment = false,
+                                .ring_bits = 0, .dreq = 0x3F};
+}
+
+// A transferência acontece de uma vez: o bloco vai para o log conforme o destino (FIFO de uma
+// máquina de estados ou DATA_CMD de uma I2C) e a interrupção de fim é chamada em seguida.
+static void sim_dma_dispara(uint channel){
+    sim_dma_t *d = &sim_dma[channel];
+
+    for(uint p = 0; p < 2; p++){
+        for(uint sm = 0; sm < 4; sm++){
+            if(d->write_addr != &sim_pio[p].txf[sm]){
+                continue;
+            }
+            if(d->config.ring_bits && (d->trans_count << d->config.size) > (1u << d->config.ring_bits)){
+                // Anel repetido indefinidamente (descritor dos buzzers): registra uma volta e
+                // não termina. Uma contagem que cabe no anel é um bloco comum (tom tocado uma vez).
+                sim_registra_palavras("PIO_ANEL", p, sm, d->read_addr, (1u << d->config.ring_bits) / 4, d->config.size);
+                return;
+            }
+            sim_registra_palavras("PIO", p, sm, d->read_addr, d->trans_count, d->config.size);
+        }
+    }
+    for(uint i = 0; i < 2; i++){
+        if(d->write_addr == &sim_i2c_hw[i].data_cmd){
+            sim_registra_palavras("I2C", i, sim_i2c_hw[i].tar, d->read_addr, d->trans_count, d->config.size);
+        }
+    }
+
+    if(d->irq0_enabled){
+        d->irq0_status = true;
+        sim_irq(DMA_IRQ_0);
+    }
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint32_t transfer_count, bool trigger){
+    sim_dma[channel].config = *config;
+    sim_dma[channel].write_addr = write_addr;
+    sim_dma[channel].read_addr = read_addr;
+    sim_dma[channel].trans_count = transfer_count;
+    if(trigger){
+        sim_dma_dispara(channel);
+    }
+}
+
+void dma_channel_transfer_from_buffer_now(uint channel, const volatile void *read_addr, uint32_t transfer_count){
+    sim_dma[channel].read_addr = read_addr;
+    sim_dma[channel].trans_count = transfer_count;
+    sim_dma_dispara(channel);
+}
+
+void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger){
+    sim_dma[channel].read_addr = read_addr;
+    if(trigger){
+        sim_dma_dispara(channel);
+    }
+}
+
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger){
+    sim_dma[channel].trans_count = trans_count;
+    if(trigger){
+        sim_dma_dispara(channel);
+    }
+}
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled){
+    sim_dma[channel].irq0_enabled = enabled;
+}
+
+bool dma_channel_get_irq0_status(uint channel){
+    return sim_dma[channel].irq0_status;
+}
+
+void dma_channel_acknowledge_irq0(uint channel){
+    sim_dma[channel].irq0_status = false;
+}
+
+void dma_channel_abort(uint channel){}
+
+// Flash ========================================================================================
+
+uint8_t sim_flash[PICO_FLASH_SIZE_BYTES];
+static const char *sim_flash_arquivo = NULL;
+
+// Apagado = 0xFF; o conteúdo salvo por uma execução anterior volta com SIM_FLASH
+static void sim_flash_carrega(void){
+    memset(sim_flash, 0xFF, sizeof(sim_flash));
+    sim_flash_arquivo = getenv("SIM_FLASH");
+    FILE *f = sim_flash_arquivo ? fopen(sim_flash_arquivo, "rb") : NULL;
+    if(f){
+        size_t lidos = fread(sim_flash, 1, sizeof(sim_flash), f);
+        (void)lidos;
+        fclose(f);
+    }
+}
+
+static void sim_flash_salva(void){
+    FILE *f = sim_flash_arquivo ? fopen(sim_flash_arquivo, "wb") : NULL;
+    if(f){
+        fwrite(sim_flash, 1, sizeof(sim_flash), f);
+        fclose(f);
+    }
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count){
+    memset(sim_flash + flash_offs, 0xFF, count);
+    sim_registra("FLASH_ERASE", "%lu,%lu", (unsigned long)flash_offs, (unsigned long)count);
+}
+
+// Como na flash real, a gravação só leva bits de 1 para 0
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count){
+    for(size_t i = 0; i < count; i++){
+        sim_flash[flash_offs + i] &= data[i];
+    }
+    sim_registra("FLASH_PROGRAM", "%lu,%lu", (unsigned long)flash_offs, (unsigned long)count);
+}
+
+// Um core só: basta não ser interrompido pelo escalonador. O arquivo é salvo uma vez por operação.
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms){
+    vTaskSuspendAll();
+    func(param);
+    xTaskResumeAll();
+    sim_flash_salva();
+    return PICO_OK;
+}
+
+// Sistema e roteiro da simulação ================================================================
+
+static void sim_fim(void);
+
+// Bytes do stdin já lidos ou disponíveis sem bloquear. O fim do stdin (o cliente fechou o pipe)
+// encerra a simulação.
+static bool sim_stdin_disponivel(void){
+    bool disponivel = true;
+    taskENTER_CRITICAL();
+    if(sim_entrada_pos == sim_entrada_tamanho){
+        struct pollfd fd = {STDIN_FILENO, POLLIN, 0};
+        disponivel = false;
+        if(poll(&fd, 1, 0) > 0){
+            ssize_t lidos = read(STDIN_FILENO, sim_entrada, sizeof(sim_entrada));
+            if(lidos <= 0){
+                taskEXIT_CRITICAL();
+                sim_fim();
+            }
+            sim_entrada_pos = 0;
+            sim_entrada_tamanho = lidos;
+            disponivel = true;
+        }
+    }
+    taskEXIT_CRITICAL();
+    return disponivel;
+}
+
+int getchar_timeout_us(uint32_t timeout_us){
+    if(!sim_stdin || !sim_stdin_disponivel()){
+        return PICO_ERROR_TIMEOUT;
+    }
+    return sim_entrada[sim_entrada_pos++];
+}
+
+// Uma única escrita no stdout, como o stdio do pico-sdk faz sob o seu mutex
+int stdio_put_string(const char *s, int len, bool newline, bool cr_translation){
+    taskENTER_CRITICAL();
+    fwrite(s, 1, len, stdout);
+    if(newline){
+        putchar('\n');
+    }
+    fflush(stdout);
+    taskEXIT_CRITICAL();
+    return len;
+}
+
+void stdio_set_chars_available_callback(void (*fn)(void *), void *param){
+    sim_chars_callback = fn;
+    sim_chars_param = param;
+}
+
+// Faz o papel da IRQ do stdio: consulta o stdin a cada tick e avisa o callback
+static void vSimStdinTask(void *params){
+    while(true){
+        if(sim_chars_callback && sim_stdin_disponivel()){
+            sim_chars_callback(sim_chars_param);
+        }
+        vTaskDelay(1);
+    }
+}
+
+void panic_unsupported(void){
+    fprintf(stderr, "(SIM) recurso de hardware nao suportado\n");
+    abort();
+}
+
+static void sim_aguarda_ate(uint64_t ms){
+    TickType_t alvo = pdMS_TO_TICKS(ms);
+    TickType_t agora = xTaskGetTickCount();
+    if(alvo > agora){
+        vTaskDelay(alvo - agora);
+    }
+}
+
+static void sim_fim(void){
+    struct timespec fim;
+    clock_gettime(CLOCK_MONOTONIC, &fim);
+    double real_s = (fim.tv_sec - sim_inicio_real.tv_sec) + (fim.tv_nsec - sim_inicio_real.tv_nsec) / 1e9;
+    taskENTER_CRITICAL();
+    printf("(SIM) %llu s simulados em %.1f s, %lu linhas no log\n",
+           (unsigned long long)(time_us_64() / 1000000), real_s, (unsigned long)sim_linhas);
+    if(sim_log){
+        fclose(sim_log);
+    }
+    exit(0);
+}
+
+// Task do roteiro: aplica os toques de SIM_BOTAO ("t_ms[:duracao_ms],...", em tempo virtual)
+// e encerra a simulação após SIM_DURACAO_S segundos
+static void vSimTask(void *params){
+    const char *p = sim_botao;
+    while(p && *p){
+        char *fim;
+        uint64_t t = strtoull(p, &fim, 10);
+        uint64_t duracao = SIM_TOQUE_MS;
+        if(*fim == ':'){
+            duracao = strtoull(fim + 1, &fim, 10);
+        }
+        sim_aguarda_ate(t);
+        sim_botao_nivel(false);
+        sim_aguarda_ate(t + duracao);
+        sim_botao_nivel(true);
+        p = (*fim == ',') ? fim + 1 : NULL;
+    }
+    if(sim_duracao_ms){
+        sim_aguarda_ate(sim_duracao_ms);
+        sim_fim();
+    }
+    vTaskSuspend(NULL);
+}
+
+// Lê a configuração do ambiente, abre o log e cria a task do roteiro (o firmware chama
+// stdio_init_all antes de criar as suas tasks)
+bool stdio_init_all(void){
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    clock_gettime(CLOCK_MONOTONIC, &sim_inicio_real);
+
+    const char *tempo = getenv("SIM_TEMPO");
+    sim_virtual = !(tempo && strcmp(tempo, "real") == 0);
+    const char *duracao = getenv("SIM_DURACAO_S");
+    sim_duracao_ms = duracao ? strtoull(duracao, NULL, 10) * 1000 : 0;
+    sim_botao = getenv("SIM_BOTAO");
+    const char *entrada = getenv("SIM_STDIN");
+    sim_stdin = entrada && strcmp(entrada, "1") == 0;
+    sim_flash_carrega();
+
+    // SIM_LOG vazio desliga o log
+    const char *log = getenv("SIM_LOG");
+    if(!log || *log){
+        sim_log = fopen(log ? log : "sim_log.csv", "w");
+        if(!sim_log){
+            perror("(SIM) log");
+            exit(1);
+        }
+        fprintf(sim_log, "t_us,tipo,dados\n");
+    }
+
+    xTaskCreateStatic(vSimTask, "Sim", SIM_STACK, NULL, tskIDLE_PRIORITY + 1, sim_stack, &sim_tcb);
+    if(sim_stdin){
+        // Com o stdin consultado a cada tick, o tempo virtual não salta mais até o próximo prazo
+        xTaskCreateStatic(vSimStdinTask, "Sim Stdin", SIM_STACK, NULL, tskIDLE_PRIORITY + 1, sim_stdin_stack, &sim_stdin_tcb);
+    }
+    return true;
+}
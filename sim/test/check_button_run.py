@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""Roteiros do botão no simulador, com o resultado conferido pelas bordas do LED RGB.
+
+- pedestre: um toque no primeiro verde encurta o verde da via principal para o verde mínimo
+  (VERDE_MINIMO_MS), em vez do verde inteiro do plano em vigor.
+- noturno: um toque longo liga o modo noturno, em que o vermelho e o verde do LED piscam juntos
+  (amarelo), aceso e apagado pelo período do pisca noturno; outro toque longo volta ao plano,
+  recomeçando por um verde inteiro.
+Os tempos vêm das fontes do firmware (sim_run.Firmware).
+    python3 sim/test/check_button_run.py build-sim/SemaforoSim
+"""
+import argparse
+import os
+import sys
+import tempfile
+
+from sim_run import PINO_VERDE, PINO_VERMELHO, Firmware, bordas_pwm, roda_sim
+
+MS = 1000
+FIRMWARE = Firmware()
+# Os roteiros duram poucos minutos depois do boot: vale o plano desse horário
+VERDE_MS = FIRMWARE.verdes_ms[FIRMWARE.plano_em(0)]
+VERDE_MINIMO_MS = FIRMWARE.verde_minimo_ms
+PISCA_NOTURNO_MS = FIRMWARE.pisca_noturno_ms
+TOQUE_LONGO_MS = FIRMWARE.toque_longo_ms
+# Tolerância para as saídas aplicadas pela task de timers depois do prazo (um tick)
+TICK_US = 1 * MS
+
+
+def primeira(bordas, pino, aceso, depois_de=0):
+    for t, p, a in bordas:
+        if p == pino and a == aceso and t >= depois_de:
+            return t
+    return None
+
+
+def pedestre(sim, tmp):
+    log = os.path.join(tmp, "pedestre.csv")
+    roda_sim(sim, 40, log, botao="1000")
+    bordas = bordas_pwm(log, {PINO_VERDE, PINO_VERMELHO})
+    verde = primeira(bordas, PINO_VERDE, True)
+    # O verde da via principal termina quando o vermelho acende (amarelo = vermelho + verde)
+    amarelo = primeira(bordas, PINO_VERMELHO, True, verde or 0)
+    if verde is None or amarelo is None:
+        return ["sem verde seguido de amarelo no log"]
+    duracao = amarelo - verde
+    if abs(duracao - VERDE_MINIMO_MS * MS) > TICK_US:
+        return [f"verde com chamada durou {duracao} us, esperado {VERDE_MINIMO_MS} ms"]
+    print(f"pedestre: verde encurtado para {duracao / MS:.0f} ms")
+    return []
+
+
+def noturno(sim, tmp):
+    log = os.path.join(tmp, "noturno.csv")
+    liga, desliga = 40000, 80000
+    roda_sim(sim, 110, log, botao=f"{liga}:2000,{desliga}:2000")
+    bordas = bordas_pwm(log, {PINO_VERDE, PINO_VERMELHO})
+    erros = []
+
+    # Modo noturno: as bordas dos dois pinos acontecem juntas, a cada PISCA_NOTURNO_MS
+    inicio = (liga + TOQUE_LONGO_MS + 500) * MS
+    fim = desliga * MS
+    instantes = {}
+    for t, p, a in bordas:
+        if inicio <= t < fim:
+            instantes.setdefault(t, {})[p] = a
+    tempos = sorted(instantes)
+    if len(tempos) < (fim - inicio) // (PISCA_NOTURNO_MS * MS) - 1:
+        erros.append(f"{len(tempos)} trocas do LED no modo noturno")
+    for t in tempos:
+        estado = instantes[t]
+        if len(estado) != 2 or estado[PINO_VERDE] != estado[PINO_VERMELHO]:
+            erros.append(f"t={t} us: vermelho e verde não piscam juntos ({estado})")
+    for anterior, atual in zip(tempos, tempos[1:]):
+        if atual - anterior != PISCA_NOTURNO_MS * MS:
+            erros.append(f"t={atual} us: pisca de {atual - anterior} us, esperado {PISCA_NOTURNO_MS} ms")
+
+    # Volta ao plano: a saída do modo noturno troca o LED para um verde inteiro
+    volta = (desliga + TOQUE_LONGO_MS) * MS
+    saida = next((t for t, _, _ in bordas if t >= volta - TICK_US), None)
+    amarelo = primeira(bordas, PINO_VERMELHO, True, (saida or 0) + 1000 * MS)
+    if saida is None or amarelo is None or saida > volta + 1000 * MS:
+        erros.append(f"sem verde logo após sair do modo noturno (saída em {saida}, amarelo em {amarelo})")
+    else:
+        apagou = primeira(bordas, PINO_VERDE, False, saida)
+        if apagou is not None and apagou < amarelo:
+            erros.append(f"t={apagou} us: verde apagou antes do amarelo")
+        if abs(amarelo - saida - VERDE_MS * MS) > TICK_US:
+            erros.append(f"primeiro verde após o modo noturno durou {amarelo - saida} us, esperado {VERDE_MS} ms")
+    if not erros:
+        print(f"noturno: {len(tempos)} trocas do pisca, verde inteiro na volta")
+    return erros
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("sim", help="executável SemaforoSim")
+    args = ap.parse_args()
+
+    erros = []
+    with tempfile.TemporaryDirectory() as tmp:
+        for roteiro in (pedestre, noturno):
+            erros += [f"{roteiro.__name__}: {e}" for e in roteiro(args.sim, tmp)]
+    for erro in erros[:20]:
+        print("FALHOU:", erro)
+    return 1 if erros else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""Confere que o ciclo do semáforo não deriva ao longo de um dia simulado.
+
+Roda o SemaforoSim por SIM_DURACAO_S (padrão: 86400 s), sem toques no botão, e lê no log do
+simulador as bordas do PWM do LED verde. O verde acende no início de cada ciclo (verde da via
+principal), então, num trecho de plano fixo, o intervalo entre duas subidas tem que ser exatamente
+o ciclo do plano em vigor, em us. Um atraso acumulado por ciclo (prazo recalculado a partir do
+instante em que a task acordou) aparece como um intervalo maior que o ciclo.
+Os planos, os ciclos e os horários de troca vêm das fontes do firmware (sim_run.Firmware). Os
+ciclos que atravessam um horário de troca ficam de fora: a troca só acontece no fim do ciclo.
+    python3 sim/test/check_phase_drift.py build-sim/SemaforoSim
+Com --log, só analisa um log já gravado.
+"""
+import argparse
+import os
+import sys
+import tempfile
+
+from sim_run import PINO_VERDE, Firmware, bordas_pwm, roda_sim
+
+
+def subidas(log, pino):
+    """Instantes (us) em que o LED do pino acende."""
+    return [t for t, _, aceso in bordas_pwm(log, {pino}) if aceso]
+
+
+def confere(tempos, firmware, duracao_s):
+    """Erros e contagem de ciclos conferidos por plano. Cada intervalo entre duas subidas é
+    conferido com o ciclo do plano em vigor no seu início, desde que o plano não mude até o fim."""
+    erros = []
+    minimo = duracao_s * 1000 // max(firmware.ciclos_ms) - 1
+    if len(tempos) < minimo:
+        erros.append(f"{len(tempos)} ciclos em {duracao_s} s, esperados ao menos {minimo}")
+    contagem = {p: 0 for p in range(len(firmware.ciclos_ms))}
+    trocas = 0
+    for anterior, atual in zip(tempos, tempos[1:]):
+        plano = firmware.plano_em(anterior)
+        if firmware.plano_em(atual) != plano:
+            trocas += 1
+            continue
+        intervalo = atual - anterior
+        ciclo = firmware.ciclos_ms[plano] * 1000
+        if intervalo == ciclo:
+            contagem[plano] += 1
+        else:
+            erros.append(f"ciclo de {intervalo} us em t={atual} us ({intervalo - ciclo:+d} us em relação ao ciclo de "
+                         f"{ciclo // 1000} ms do plano {plano})")
+    return erros, contagem, trocas
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("sim", nargs="?", help="executável SemaforoSim")
+    ap.add_argument("--log", help="analisa um log já gravado em vez de rodar o simulador")
+    ap.add_argument("--duracao", type=int, default=86400, help="segundos simulados (padrão: 86400)")
+    args = ap.parse_args()
+    if not args.sim and not args.log:
+        ap.error("informe o SemaforoSim ou --log")
+
+    with tempfile.TemporaryDirectory() as tmp:
+        log = args.log
+        if not log:
+            log = os.path.join(tmp, "sim_log.csv")
+            roda_sim(args.sim, args.duracao, log)
+        tempos = subidas(log, PINO_VERDE)
+
+    firmware = Firmware()
+    erros, contagem, trocas = confere(tempos, firmware, args.duracao)
+    for erro in erros[:20]:
+        print("FALHOU:", erro)
+    resumo = ", ".join(f"{n} do plano {p} ({firmware.ciclos_ms[p]} ms)" for p, n in sorted(contagem.items()))
+    print(f"{len(tempos)} inícios de ciclo em {args.duracao} s: {resumo}, {trocas} na troca de plano")
+    return 1 if erros else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
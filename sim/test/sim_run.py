@@ -0,0 +1,107 @@
+"""Execução do SemaforoSim e leitura do log, comuns aos testes de sim/test."""
+import csv
+import os
+import re
+import subprocess
+
+# Pinos do LED RGB em SemaforoMultithread.c
+PINO_VERDE = 11
+PINO_VERMELHO = 13
+
+FIRMWARE_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..")
+
+
+class Firmware:
+    """Tempos e planos padrão lidos das fontes do firmware, para os testes não guardarem cópias
+    que deixariam de bater com o firmware sem aviso."""
+
+    def __init__(self, diretorio=FIRMWARE_DIR):
+        with open(os.path.join(diretorio, "SemaforoMultithread.c"), encoding="utf-8") as f:
+            principal = f.read()
+        with open(os.path.join(diretorio, "lib", "button.h"), encoding="utf-8") as f:
+            botao = f.read()
+        self.verde_minimo_ms = _define(principal, "VERDE_MINIMO_MS")
+        self.espera_maxima_ms = _define(principal, "ESPERA_MAXIMA_MS")
+        self.relogio_inicio_min = _define(principal, "RELOGIO_INICIO_MIN")
+        self.toque_longo_ms = _define(botao, "BUTTON_LONG_PRESS_MS")
+
+        # Tabelas da PlanosPadrao: cada plano é uma faixa (primeiro, quantidade) dos intervalos
+        padrao = _bloco(principal, "const PlanosPadrao planos_padrao")
+        intervalos = [int(d) for d in re.findall(r"\{[^{}]*,\s*(\d+)\},", _bloco(padrao, ".intervalos"))]
+        planos = [(int(a), int(b)) for a, b in re.findall(r"\{(\d+),\s*(\d+),\s*\d+\}", _bloco(padrao, ".planos"))]
+        if not intervalos or not planos:
+            raise ValueError("planos padrão não encontrados em SemaforoMultithread.c")
+        self.ciclos_ms = [sum(intervalos[p:p + n]) for p, n in planos]
+        self.verdes_ms = [intervalos[p] for p, _ in planos]  # O primeiro intervalo é o verde da via principal
+        self.horarios = [(_avalia(m), int(p)) for m, p in re.findall(r"\{([\d\s*+]+),\s*(\d+)\}", _bloco(padrao, ".horarios"))]
+
+        # Pisca do modo noturno: o padrão de dois passos (aceso, apagado) do LED RGB
+        pisca = re.search(r"PATTERN\(\{NIVEL_ON,\s*(\d+)\},\s*\{0,\s*(\d+)\}\)", principal)
+        self.pisca_noturno_ms = int(pisca.group(1))
+
+    def plano_em(self, t_us):
+        """Plano padrão em vigor t_us após o boot, pelo relógio do dia (RELOGIO_INICIO_MIN no boot)."""
+        minuto = (self.relogio_inicio_min + t_us // 60000000) % 1440
+        plano = self.horarios[-1][1]  # Antes do primeiro horário do dia vale o último do dia anterior
+        for inicio, p in self.horarios:
+            if inicio <= minuto:
+                plano = p
+        return plano
+
+
+def _avalia(expressao):
+    """Valor de uma expressão inteira simples do C (números, +, *, parênteses)."""
+    if not re.fullmatch(r"[\d\s*+()]+", expressao):
+        raise ValueError(f"expressão não suportada: {expressao}")
+    return eval(expressao, {"__builtins__": {}})
+
+
+def _define(texto, nome):
+    m = re.search(r"^#define\s+%s\s+([^/\n]+)" % nome, texto, re.M)
+    if not m:
+        raise ValueError(f"#define {nome} não encontrado")
+    return _avalia(m.group(1).strip())
+
+
+def _bloco(texto, inicio):
+    """Conteúdo entre as chaves que seguem inicio (contando o aninhamento)."""
+    i = texto.index("{", texto.index(inicio))
+    nivel = 0
+    for j in range(i, len(texto)):
+        nivel += {"{": 1, "}": -1}.get(texto[j], 0)
+        if nivel == 0:
+            return re.sub(r"//[^\n]*", "", texto[i + 1:j])
+    raise ValueError(f"bloco {inicio} sem fim")
+
+
+def roda_sim(sim, duracao_s, log, botao=None):
+    """Roda o simulador com os planos padrão, gravando o log em log."""
+    env = dict(os.environ, SIM_DURACAO_S=str(duracao_s), SIM_LOG=log)
+    env.pop("SIM_FLASH", None)  # Sem imagem na flash: valem os planos padrão
+    env.pop("SIM_BOTAO", None)
+    if botao:
+        env["SIM_BOTAO"] = botao
+    subprocess.run([sim], env=env, check=True, stdout=subprocess.DEVNULL, timeout=600)
+
+
+def bordas_pwm(log, pinos):
+    """Trocas de nível do PWM dos pinos, em ordem: lista de (t_us, pino, aceso).
+    Um pino que apaga e acende no mesmo instante (dois padrões trocados em seguida) não tem borda."""
+    bordas = []
+    aceso = {}
+    with open(log, newline="") as f:
+        for linha in csv.reader(f):
+            if len(linha) < 4 or linha[1] != "PWM" or int(linha[2]) not in pinos:
+                continue
+            t = int(linha[0])
+            pino = int(linha[2])
+            novo = int(linha[3]) > 0
+            if aceso.get(pino, False) == novo:
+                continue
+            aceso[pino] = novo
+            anterior = next((i for i in range(len(bordas) - 1, -1, -1) if bordas[i][1] == pino), None)
+            if anterior is not None and bordas[anterior][0] == t:
+                del bordas[anterior]
+            else:
+                bordas.append((t, pino, novo))
+    return bordas
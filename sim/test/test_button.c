@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include "button.h"
+#include "FreeRTOS.h"
+#include "timers.h"
+
+// Testes do botão sem escalonador: o tempo é um contador de ticks deste arquivo, e os one-shots
+// da FreeRTOS são mocks que expiram quando o contador alcança o prazo, chamando o callback como
+// a task de timers faria. As bordas (e os bounces) chamam a IRQ registrada no button_init.
+
+static uint falhas = 0;
+#define CONFERE(cond, ...) do{ \
+        if(!(cond)){ \
+            printf("FALHOU %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            falhas++; \
+        } \
+    }while(0)
+
+// MOCKS DO GPIO, DO TEMPO E DOS TIMERS =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+#define PINO 5
+static TickType_t agora = 0;
+static bool nivel = true; // Solto: pull-up
+static gpio_irq_callback_t irq = NULL;
+
+typedef struct {
+    TickType_t periodo;
+    TickType_t prazo;
+    bool ativo;
+    TimerCallbackFunction_t callback;
+} timer_mock_t;
+#define TIMERS 8
+static timer_mock_t timers[TIMERS];
+static uint timers_criados = 0;
+
+void gpio_init(uint gpio){}
+void gpio_set_dir(uint gpio, bool out){}
+void gpio_pull_up(uint gpio){}
+
+bool gpio_get(uint gpio){
+    return nivel;
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback){
+    irq = callback;
+}
+
+TickType_t xTaskGetTickCount(void){
+    return agora;
+}
+
+TickType_t xTaskGetTickCountFromISR(void){
+    return agora;
+}
+
+void vPortYield(void){}
+
+TimerHandle_t xTimerCreateStatic(const char * const nome, const TickType_t periodo, const BaseType_t recarrega,
+                                 void * const id, TimerCallbackFunction_t callback, StaticTimer_t *buffer){
+    timer_mock_t *t = &timers[timers_criados++ % TIMERS];
+    *t = (timer_mock_t){.periodo = periodo, .callback = callback};
+    return (TimerHandle_t)t;
+}
+
+// Os comandos (xTimerReset, xTimerStop, ...FromISR) são macros sobre as funções genéricas;
+// o valor opcional de um reset é o tick em que ele foi pedido
+static BaseType_t comando(TimerHandle_t timer, BaseType_t id, TickType_t valor){
+    timer_mock_t *t = (timer_mock_t *)timer;
+    switch(id){
+        case tmrCOMMAND_START:
+        case tmrCOMMAND_RESET:
+        case tmrCOMMAND_START_FROM_ISR:
+        case tmrCOMMAND_RESET_FROM_ISR:
+            t->prazo = valor + t->periodo;
+            t->ativo = true;
+            break;
+        case tmrCOMMAND_STOP:
+        case tmrCOMMAND_STOP_FROM_ISR:
+            t->ativo = false;
+            break;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTimerGenericCommandFromTask(TimerHandle_t timer, const BaseType_t id, const TickType_t valor,
+                                        BaseType_t * const higher_priority_woken, const TickType_t espera){
+    return comando(timer, id, valor);
+}
+
+BaseType_t xTimerGenericCommandFromISR(TimerHandle_t timer, const BaseType_t id, const TickType_t valor,
+                                       BaseType_t * const higher_priority_woken, const TickType_t espera){
+    return comando(timer, id, valor);
+}
+
+// Avança o tempo tick a tick, expirando os one-shots no seu prazo
+static void avanca(uint32_t ms){
+    for(TickType_t fim = agora + pdMS_TO_TICKS(ms); agora != fim;){
+        agora++;
+        for(uint i = 0; i < timers_criados && i < TIMERS; i++){
+            if(timers[i].ativo && timers[i].prazo == agora){
+                timers[i].ativo = false;
+                timers[i].callback((TimerHandle_t)&timers[i]);
+            }
+        }
+    }
+}
+
+// Borda no pino: o nível muda e a IRQ é chamada, como na interrupção do GPIO
+static void borda(bool novo_nivel){
+    nivel = novo_nivel;
+    irq(PINO, novo_nivel ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL);
+}
+
+// Toque com bounce: três bordas em 2 ms ao apertar e ao soltar, mantido por ms
+static void toque(uint32_t ms){
+    borda(false); avanca(1); borda(true); avanca(1); borda(false);
+    avanca(ms);
+    borda(true); avanca(1); borda(false); avanca(1); borda(true);
+}
+
+// Eventos recebidos, com o tick de cada um
+#define EVENTOS 8
+static button_event_t eventos[EVENTOS];
+static TickType_t eventos_tick[EVENTOS];
+static uint eventos_n = 0;
+
+static void evento(button_event_t e){
+    if(eventos_n < EVENTOS){
+        eventos[eventos_n] = e;
+        eventos_tick[eventos_n] = agora;
+    }
+    eventos_n++;
+}
+
+static void reinicia(uint32_t long_press_ms, uint32_t double_press_ms){
+    const button_config_t config = {BUTTON_DEBOUNCE_MS, long_press_ms, double_press_ms};
+    timers_criados = 0;
+    eventos_n = 0;
+    nivel = true;
+    button_init(PINO, &config, evento);
+}
+
+// TESTES =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Com o toque longo ativo, o toque simples só é decidido na soltura, antes de long_press_ms
+static void teste_toque_curto(void){
+    reinicia(BUTTON_LONG_PRESS_MS, 0);
+    borda(false); avanca(1); borda(true); avanca(1); borda(false);
+    avanca(BUTTON_DEBOUNCE_MS + 200);
+    CONFERE(eventos_n == 0, "%u evento(s) com o botao ainda apertado", eventos_n);
+    TickType_t soltura = agora;
+    borda(true); avanca(1); borda(false); avanca(1); borda(true);
+    avanca(BUTTON_LONG_PRESS_MS * 2);
+    CONFERE(eventos_n == 1 && eventos[0] == BUTTON_EVT_PRESS, "toque curto: %u evento(s), primeiro %d", eventos_n,
+            eventos_n ? (int)eventos[0] : -1);
+    // Um debounce depois da última borda da soltura
+    CONFERE(eventos_n && eventos_tick[0] == soltura + 2 + pdMS_TO_TICKS(BUTTON_DEBOUNCE_MS),
+            "toque curto no tick %lu, soltura no %lu", (unsigned long)eventos_tick[0], (unsigned long)soltura);
+
+    // Solto pouco antes de long_press_ms: ainda é um toque simples
+    eventos_n = 0;
+    toque(BUTTON_LONG_PRESS_MS - BUTTON_DEBOUNCE_MS);
+    avanca(BUTTON_LONG_PRESS_MS * 2);
+    CONFERE(eventos_n == 1 && eventos[0] == BUTTON_EVT_PRESS, "toque no limite: %u evento(s)", eventos_n);
+}
+
+// Mantido além de long_press_ms: só o toque longo, no tempo, e nada na soltura
+static void teste_toque_longo(void){
+    reinicia(BUTTON_LONG_PRESS_MS, 0);
+    borda(false); avanca(1); borda(true); avanca(1); borda(false);
+    TickType_t aperto = agora;
+    avanca(BUTTON_DEBOUNCE_MS + BUTTON_LONG_PRESS_MS + 500);
+    CONFERE(eventos_n == 1 && eventos[0] == BUTTON_EVT_LONG_PRESS, "toque longo: %u evento(s)", eventos_n);
+    CONFERE(eventos_n && eventos_tick[0] == aperto + pdMS_TO_TICKS(BUTTON_DEBOUNCE_MS + BUTTON_LONG_PRESS_MS),
+            "toque longo no tick %lu, aperto no %lu", (unsigned long)eventos_tick[0], (unsigned long)aperto);
+    borda(true); avanca(1); borda(false); avanca(1); borda(true);
+    avanca(BUTTON_LONG_PRESS_MS * 2);
+    CONFERE(eventos_n == 1, "a soltura do toque longo gerou %u evento(s) a mais", eventos_n - 1);
+}
+
+// Dois toques dentro da janela: só o duplo. Um toque sozinho: o simples, ao fim da janela
+static void teste_toque_duplo(void){
+    reinicia(BUTTON_LONG_PRESS_MS, BUTTON_DOUBLE_PRESS_MS);
+    toque(100);
+    avanca(100);
+    CONFERE(eventos_n == 0, "%u evento(s) antes do segundo toque", eventos_n);
+    toque(100);
+    avanca(BUTTON_DOUBLE_PRESS_MS * 2);
+    CONFERE(eventos_n == 1 && eventos[0] == BUTTON_EVT_DOUBLE_PRESS, "toque duplo: %u evento(s), primeiro %d",
+            eventos_n, eventos_n ? (int)eventos[0] : -1);
+
+    eventos_n = 0;
+    toque(100);
+    TickType_t solto = agora;
+    avanca(BUTTON_DOUBLE_PRESS_MS * 2);
+    CONFERE(eventos_n == 1 && eventos[0] == BUTTON_EVT_PRESS, "toque sozinho: %u evento(s)", eventos_n);
+    CONFERE(eventos_n && eventos_tick[0] == solto + pdMS_TO_TICKS(BUTTON_DEBOUNCE_MS + BUTTON_DOUBLE_PRESS_MS),
+            "toque sozinho no tick %lu, soltura no %lu", (unsigned long)eventos_tick[0], (unsigned long)solto);
+
+    // Um toque simples seguido de um longo dentro da janela: só o longo
+    eventos_n = 0;
+    toque(100);
+    toque(BUTTON_LONG_PRESS_MS + 200);
+    avanca(BUTTON_DOUBLE_PRESS_MS * 2);
+    CONFERE(eventos_n == 1 && eventos[0] == BUTTON_EVT_LONG_PRESS, "simples e longo: %u evento(s)", eventos_n);
+}
+
+// Pulso mais curto que o debounce: o nível volta ao anterior e nada é gerado
+static void teste_ruido(void){
+    reinicia(BUTTON_LONG_PRESS_MS, 0);
+    borda(false); avanca(BUTTON_DEBOUNCE_MS - 5); borda(true);
+    avanca(BUTTON_LONG_PRESS_MS * 2);
+    CONFERE(eventos_n == 0, "ruido gerou %u evento(s)", eventos_n);
+}
+
+int main(void){
+    teste_toque_curto();
+    teste_toque_longo();
+    teste_toque_duplo();
+    teste_ruido();
+    if(falhas){
+        printf("%u falha(s)\n", falhas);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <string.h>
+#include "buzzer.h"
+
+// Testes do buzzer sem o kernel: a PIO e a DMA são mocks deste arquivo. Cada disparo da DMA lê
+// as palavras do descritor como o hardware leria (em anel de 16 bytes) e as guarda na FIFO da
+// máquina de estados de destino; toda leitura dentro da flash simulada (sim_flash) é contada.
+
+static uint falhas = 0;
+#define CONFERE(cond, ...) do{ \
+        if(!(cond)){ \
+            printf("FALHOU %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            falhas++; \
+        } \
+    }while(0)
+
+// MOCKS DOS PERIFÉRICOS =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+uint8_t sim_flash[PICO_FLASH_SIZE_BYTES] __attribute__((aligned(FLASH_SECTOR_SIZE)));
+pio_hw_t sim_pio[2] = {{.index = 0}, {.index = 1}};
+static uint sms_usadas = 0;
+static uint32_t sms_em_sincronia = 0;
+
+#define CANAIS_DMA 4
+#define PALAVRAS_LIDAS 8 // Palavras lidas por disparo: duas voltas do anel de um descritor
+typedef struct {
+    dma_channel_config config;
+    volatile void *write_addr;
+    const volatile void *read_addr;
+    uint32_t trans_count;
+    uint32_t fifo[PALAVRAS_LIDAS]; // Palavras entregues no último disparo
+    uint lidas;
+} dma_mock_t;
+static dma_mock_t dma[CANAIS_DMA];
+static uint dma_usados = 0;
+static uint leituras_da_flash = 0;
+
+uint pio_add_program(PIO pio, const pio_program_t *program){
+    return 0;
+}
+
+int pio_claim_unused_sm(PIO pio, bool required){
+    return sms_usadas++;
+}
+
+void pio_gpio_init(PIO pio, uint pin){}
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin, uint count, bool is_out){}
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config){}
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled){}
+void pio_sm_clear_fifos(PIO pio, uint sm){}
+void pio_sm_restart(PIO pio, uint sm){}
+void pio_sm_exec(PIO pio, uint sm, uint instr){}
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask){}
+
+void pio_enable_sm_mask_in_sync(PIO pio, uint32_t mask){
+    sms_em_sincronia = mask;
+}
+
+int dma_claim_unused_channel(bool required){
+    return dma_usados++;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel){
+    return (dma_channel_config){.size = DMA_SIZE_32, .read_increment = true};
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint32_t transfer_count, bool trigger){
+    dma[channel].config = *config;
+    dma[channel].write_addr = write_addr;
+    dma[channel].read_addr = read_addr;
+    dma[channel].trans_count = transfer_count;
+}
+
+// Lê como a DMA: o endereço avança e, com anel, volta ao início do bloco alinhado de 2^ring_bits bytes
+static void dma_le(uint channel){
+    dma_mock_t *d = &dma[channel];
+    uintptr_t base = (uintptr_t)d->read_addr;
+    uintptr_t anel = d->config.ring_bits ? (1u << d->config.ring_bits) - 1 : UINTPTR_MAX;
+    d->lidas = d->trans_count < PALAVRAS_LIDAS ? d->trans_count : PALAVRAS_LIDAS;
+    for(uint i = 0; i < d->lidas; i++){
+        uintptr_t endereco = (base & ~anel) | ((base + 4 * i) & anel);
+        if(endereco >= (uintptr_t)sim_flash && endereco < (uintptr_t)sim_flash + sizeof(sim_flash)){
+            leituras_da_flash++;
+        }
+        d->fifo[i] = *(const uint32_t *)endereco;
+    }
+}
+
+void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger){
+    dma[channel].read_addr = read_addr;
+    if(trigger){
+        dma_le(channel);
+    }
+}
+
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger){
+    dma[channel].trans_count = trans_count;
+    if(trigger){
+        dma_le(channel);
+    }
+}
+
+void dma_channel_abort(uint channel){
+    dma[channel].lidas = 0;
+}
+
+// TESTES =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+static const uint pinos[BUZZER_CHANNELS] = {10, 21};
+// Tons diferentes nos dois canais: A toca uma vez, B repete a cadência
+static const buzzer_tone_t tom_a = BUZZER_TONE(880, 50, 1000, 0);
+static const buzzer_tone_t tom_b = BUZZER_TONE(1320, 50, 250, 750);
+
+// Canal de DMA que alimenta a máquina de estados sm
+static dma_mock_t *dma_da_sm(uint sm){
+    for(uint c = 0; c < dma_usados; c++){
+        if(dma[c].write_addr == &sim_pio[0].txf[sm]){
+            return &dma[c];
+        }
+    }
+    return NULL;
+}
+
+// As palavras entregues à FIFO são as do tom, repetidas em anel só quando há cadência
+static void confere_fifo(uint sm, const buzzer_tone_t *tom, const char *nome){
+    dma_mock_t *d = dma_da_sm(sm);
+    if(!d){
+        CONFERE(false, "%s: sem DMA para a maquina de estados %u", nome, sm);
+        return;
+    }
+    uint palavras = tom->silencio == BUZZER_ONCE ? 4 : PALAVRAS_LIDAS;
+    CONFERE(d->lidas == palavras, "%s: %u palavras lidas, esperadas %u", nome, d->lidas, palavras);
+    for(uint i = 0; i < d->lidas; i++){
+        CONFERE(d->fifo[i] == ((const uint32_t *)tom)[i % 4], "%s: palavra %u entregue %08lx", nome, i,
+                (unsigned long)d->fifo[i]);
+    }
+}
+
+// Os dois canais tocam tons diferentes ao mesmo tempo, partindo juntos
+static void teste_dois_canais(const buzzer_tone_t *tons_flash[BUZZER_CHANNELS]){
+    buzzer_play(tons_flash);
+    CONFERE(sms_em_sincronia == 0x3, "maquinas de estados em sincronia: %lx", (unsigned long)sms_em_sincronia);
+    CONFERE(dma_da_sm(0) && dma_da_sm(1) && dma_da_sm(0)->read_addr != dma_da_sm(1)->read_addr,
+            "os canais deveriam ler descritores distintos");
+    confere_fifo(0, &tom_a, "canal A");
+    confere_fifo(1, &tom_b, "canal B");
+    CONFERE(dma_da_sm(0)->trans_count == 4 && dma_da_sm(1)->trans_count == 0xFFFFFFFF,
+            "contagens: %lu (tom unico) e %lu (cadencia)", (unsigned long)dma_da_sm(0)->trans_count,
+            (unsigned long)dma_da_sm(1)->trans_count);
+}
+
+// Com os tons na flash, a DMA nunca lê a flash: um apagamento do setor (plan_store) durante o
+// tom não muda o que a PIO recebe nas voltas seguintes do anel
+static void teste_sem_leitura_da_flash(void){
+    CONFERE(leituras_da_flash == 0, "%u leituras da flash pela DMA", leituras_da_flash);
+    memset(sim_flash, 0xFF, FLASH_SECTOR_SIZE);
+    dma_le(dma_da_sm(1) - dma); // Nova volta do anel do canal B, depois do apagamento
+    CONFERE(leituras_da_flash == 0, "%u leituras da flash pela DMA apos o apagamento", leituras_da_flash);
+    confere_fifo(1, &tom_b, "canal B apos o apagamento");
+
+    // Silêncio num canal não muda o outro
+    const buzzer_tone_t *so_b[BUZZER_CHANNELS] = {NULL, &tom_b};
+    buzzer_play(so_b);
+    CONFERE(sms_em_sincronia == 0x2, "so o canal B deveria partir: %lx", (unsigned long)sms_em_sincronia);
+    confere_fifo(1, &tom_b, "canal B sozinho");
+}
+
+int main(void){
+    buzzer_init(pio0, pinos);
+    // Os tons ficam no primeiro setor da flash simulada, como as constantes do firmware no XIP
+    memcpy(&sim_flash[0], &tom_a, sizeof(tom_a));
+    memcpy(&sim_flash[sizeof(tom_a)], &tom_b, sizeof(tom_b));
+    const buzzer_tone_t *tons_flash[BUZZER_CHANNELS] = {(const buzzer_tone_t *)&sim_flash[0],
+                                                        (const buzzer_tone_t *)&sim_flash[sizeof(tom_a)]};
+    teste_dois_canais(tons_flash);
+    teste_sem_leitura_da_flash();
+    if(falhas){
+        printf("%u falha(s)\n", falhas);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
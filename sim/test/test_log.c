@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <string.h>
+#include <setjmp.h>
+#include <unistd.h>
+#include "log.h"
+#include "task.h"
+
+// Testes do log adiado sem escalonador: o produtor e o consumidor de cada anel rodam em sequência
+// neste arquivo. O tempo, a task atual e o seu thread local storage são mocks; a task do log é
+// executada uma volta por vez (o vTaskDelay volta para o teste), com o stdout num arquivo.
+
+static uint falhas = 0;
+#define CONFERE(cond, ...) do{ \
+        if(!(cond)){ \
+            printf("FALHOU %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            falhas++; \
+        } \
+    }while(0)
+
+// MOCKS DO TEMPO E DO KERNEL =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+static uint32_t agora_us = 0;
+#define TAREFAS (LOG_TASK_RINGS + 1)
+static const char *const nomes[TAREFAS] = {"T0", "T1", "T2", "T3", "T4", "T5", "T6"};
+static void *tls[TAREFAS];
+static uint tarefa = 0; // Task "em execução"
+static TaskFunction_t tarefa_log = NULL;
+static jmp_buf volta_da_tarefa;
+
+uint32_t time_us_32(void){
+    return agora_us;
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t task, const char *const nome, const configSTACK_DEPTH_TYPE stack_words,
+                               void *const param, UBaseType_t prioridade, StackType_t *const stack, StaticTask_t *const tcb){
+    tarefa_log = task;
+    return (TaskHandle_t)tcb;
+}
+
+// Fim de uma volta da task do log
+void vTaskDelay(TickType_t ticks){
+    longjmp(volta_da_tarefa, 1);
+}
+
+void vPortEnterCritical(void){}
+void vPortExitCritical(void){}
+
+void *pvTaskGetThreadLocalStoragePointer(TaskHandle_t task, BaseType_t indice){
+    return indice == LOG_TLS_RING ? tls[tarefa] : NULL;
+}
+
+void vTaskSetThreadLocalStoragePointer(TaskHandle_t task, BaseType_t indice, void *valor){
+    if(indice == LOG_TLS_RING){
+        tls[tarefa] = valor;
+    }
+}
+
+const char *pcTaskGetName(TaskHandle_t task){
+    return nomes[tarefa];
+}
+
+// Uma volta da task do log; o que ela imprimiu fica em impresso
+static char impresso[4096];
+static void executa_log(void){
+    fflush(stdout);
+    int stdout_salvo = dup(STDOUT_FILENO);
+    FILE *arquivo = tmpfile();
+    dup2(fileno(arquivo), STDOUT_FILENO);
+    if(!setjmp(volta_da_tarefa)){
+        tarefa_log(NULL);
+    }
+    fflush(stdout);
+    dup2(stdout_salvo, STDOUT_FILENO);
+    close(stdout_salvo);
+    rewind(arquivo);
+    size_t n = fread(impresso, 1, sizeof(impresso) - 1, arquivo);
+    impresso[n] = '\0';
+    fclose(arquivo);
+}
+
+// TESTES =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+static const char formato[] = "reg %lu\n";
+
+// Retira o próximo registro e confere que é o valor esperado
+static void confere_leitura(uintptr_t valor){
+    log_record_t r;
+    bool leu = log_read(&r);
+    CONFERE(leu && r.formato == formato && r.args[0] == valor && r.tempo_us == (uint32_t)valor,
+            "registro %lu: lido %d, valor %lu", (unsigned long)valor, leu, leu ? (unsigned long)r.args[0] : 0ul);
+}
+
+static bool registra(uintptr_t valor){
+    agora_us = valor;
+    return log_write(NULL, formato, valor, 0, 0, 0);
+}
+
+// Antes da task do log, os registros vão para o anel do core. Escritas e leituras alternadas
+// dão várias voltas no anel, sempre na ordem
+static void teste_volta_do_anel(void){
+    uintptr_t escrito = 0, lido = 0;
+    for(uint volta = 0; volta < 10; volta++){
+        for(uint i = 0; i < 5; i++){
+            CONFERE(registra(escrito++), "registro %lu descartado", (unsigned long)escrito - 1);
+        }
+        for(uint i = 0; i < 5; i++){
+            confere_leitura(lido++);
+        }
+    }
+    log_record_t r;
+    CONFERE(!log_read(&r), "anel deveria estar vazio depois de %lu registros", (unsigned long)escrito);
+}
+
+// Anel cheio atravessando o fim do vetor: os excedentes são descartados e contados, e uma
+// leitura libera exatamente um lugar
+static void teste_anel_cheio(void){
+    uintptr_t escrito = 100, lido = 100;
+    for(uint i = 0; i < LOG_RING_SIZE - 4; i++){
+        registra(escrito++);
+    }
+    for(uint i = 0; i < 8; i++){
+        confere_leitura(lido++);
+    }
+    for(uint i = 0; i < 12; i++){
+        CONFERE(registra(escrito++), "registro %lu descartado com lugar no anel", (unsigned long)escrito - 1);
+    }
+    for(uint i = 0; i < 3; i++){
+        CONFERE(!registra(1000 + i), "registro aceito com o anel cheio");
+    }
+    confere_leitura(lido++);
+    CONFERE(registra(escrito++), "registro descartado depois de uma leitura");
+    CONFERE(!registra(1003), "registro aceito com o anel cheio de novo");
+    while(lido < escrito){
+        confere_leitura(lido++);
+    }
+}
+
+// Limite de taxa de um ponto de log, atravessando a volta do time_us_32
+static void teste_limite_de_taxa(void){
+    log_limit_t limite = {10000, 0, false};
+    uint32_t inicio = 0xFFFFFFFFu - 8000; // Volta entre 5 ms e 9,999 ms depois
+    agora_us = inicio;
+    CONFERE(log_write(&limite, formato, 1, 0, 0, 0), "primeira linha do ponto descartada");
+    agora_us = inicio + 5000;
+    CONFERE(!log_write(&limite, formato, 2, 0, 0, 0), "linha aceita 5 ms depois");
+    agora_us = inicio + 9999;
+    CONFERE(!log_write(&limite, formato, 3, 0, 0, 0), "linha aceita 9,999 ms depois");
+    agora_us = inicio + 10000;
+    CONFERE(log_write(&limite, formato, 4, 0, 0, 0), "linha descartada 10 ms depois, apos a volta do relogio");
+    CONFERE(log_write(NULL, formato, 5, 0, 0, 0), "linha sem limite descartada");
+    log_record_t r;
+    uint lidos = 0;
+    while(log_read(&r)){
+        lidos++;
+    }
+    CONFERE(lidos == 3, "%u linhas no anel, esperadas 3", lidos);
+}
+
+// A task do log informa os descartes do anel do core uma vez, pela diferença desde o último aviso
+static void teste_contadores_de_descarte(void){
+    executa_log();
+    CONFERE(strcmp(impresso, "(LOG) ISR core 0: 4 linhas descartadas com o anel cheio, 2 pelo limite de taxa\n") == 0,
+            "aviso dos descartes: \"%s\"", impresso);
+    executa_log();
+    CONFERE(impresso[0] == '\0', "sem descartes novos, impresso: \"%s\"", impresso);
+    // Com a task do log rodando, a task atual (T0) registra no seu próprio anel
+    agora_us = 0;
+    while(registra(agora_us + 1)){}
+    executa_log();
+    CONFERE(strstr(impresso, "reg 16\n(LOG) T0: 1 linhas descartadas com o anel cheio, 0 pelo limite de taxa\n") != NULL &&
+            strstr(impresso, "ISR core 0") == NULL, "so o descarte novo, do anel da task, deveria ser informado: \"%s\"", impresso);
+}
+
+// Com a task do log ativa, cada task ganha o seu anel; a impressão intercala os anéis pelo tempo,
+// e as tasks além de LOG_TASK_RINGS são contadas à parte
+static void teste_aneis_das_tasks(void){
+    tarefa = 1; agora_us = 100; LOG("%s %lu\n", nomes[tarefa], agora_us);
+    tarefa = 0; agora_us = 200; LOG("%s %lu\n", nomes[tarefa], agora_us);
+    tarefa = 1; agora_us = 300; LOG("%s %lu\n", nomes[tarefa], agora_us);
+    executa_log();
+    CONFERE(strcmp(impresso, "T1 100\nT0 200\nT1 300\n") == 0, "ordem entre os aneis: \"%s\"", impresso);
+
+    for(tarefa = 2; tarefa < LOG_TASK_RINGS; tarefa++){
+        CONFERE(log_write(NULL, formato, tarefa, 0, 0, 0), "task %s sem anel", nomes[tarefa]);
+    }
+    CONFERE(!log_write(NULL, formato, tarefa, 0, 0, 0), "task alem de LOG_TASK_RINGS com anel");
+    tarefa = 0;
+    for(uint i = 0; i < LOG_RING_SIZE + 2; i++){
+        log_write(NULL, formato, i, 0, 0, 0);
+    }
+    executa_log();
+    CONFERE(strstr(impresso, "(LOG) T0: 2 linhas descartadas com o anel cheio, 0 pelo limite de taxa\n") != NULL,
+            "descartes da task T0 nao informados: \"%s\"", impresso);
+    CONFERE(strstr(impresso, "(LOG) 1 linhas descartadas sem anel livre (LOG_TASK_RINGS)\n") != NULL,
+            "task sem anel nao informada: \"%s\"", impresso);
+    CONFERE(strstr(impresso, "ISR core 0") == NULL, "o anel do core nao teve descartes novos: \"%s\"", impresso);
+}
+
+int main(void){
+    log_init();
+    teste_volta_do_anel();
+    teste_anel_cheio();
+    teste_limite_de_taxa();
+    teste_contadores_de_descarte();
+    teste_aneis_das_tasks();
+    if(falhas){
+        printf("%u falha(s)\n", falhas);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,283 @@
+#include <stdio.h>
+#include <string.h>
+#include "protocol.h"
+#include "plan_store.h"
+#include "task.h"
+
+// Testes do protocolo sem escalonador: os quadros são entregues byte a byte ao protocol_feed, e
+// as respostas escritas pelo stdio_put_string são decodificadas aqui, com um COBS e um CRC-32
+// próprios (bit a bit, o mesmo do zlib) para conferir os do firmware. Só os cabeçalhos do
+// kernel são usados: a criação da task e as notificações são mocks.
+
+static uint falhas = 0;
+#define CONFERE(cond, ...) do{ \
+        if(!(cond)){ \
+            printf("FALHOU %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            falhas++; \
+        } \
+    }while(0)
+
+// MOCKS DO STDIO, DA FLASH E DO KERNEL =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+uint8_t sim_flash[PICO_FLASH_SIZE_BYTES];
+static uint8_t saida[4096];
+static uint saida_tamanho = 0;
+static uint escritas = 0;
+
+int stdio_put_string(const char *s, int len, bool newline, bool cr_translation){
+    if(saida_tamanho + len <= sizeof(saida)){
+        memcpy(&saida[saida_tamanho], s, len);
+        saida_tamanho += len;
+    }
+    escritas++;
+    return len;
+}
+
+void stdio_set_chars_available_callback(void (*fn)(void *), void *param){}
+
+int getchar_timeout_us(uint32_t timeout_us){
+    return PICO_ERROR_TIMEOUT;
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count){}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count){}
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms){
+    return PICO_OK;
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t task, const char *const nome, const configSTACK_DEPTH_TYPE stack_words,
+                               void *const param, UBaseType_t prioridade, StackType_t *const stack, StaticTask_t *const tcb){
+    return (TaskHandle_t)tcb;
+}
+
+// As notificações são macros sobre as funções genéricas (com o índice da notificação)
+void vTaskGenericNotifyGiveFromISR(TaskHandle_t task, UBaseType_t indice, BaseType_t *higher_priority_woken){}
+
+uint32_t ulTaskGenericNotifyTake(UBaseType_t indice, BaseType_t limpa_ao_sair, TickType_t espera){
+    return 0;
+}
+
+void vPortYield(void){}
+
+// REFERÊNCIAS DO TESTE =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+static uint32_t crc32_ref(const uint8_t *p, uint n){
+    uint32_t crc = 0xFFFFFFFF;
+    while(n--){
+        crc ^= *p++;
+        for(uint b = 0; b < 8; b++){
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+// COBS como no cliente Python: um código a cada zero ou a cada 254 bytes sem zero
+static uint cobs_encode_ref(const uint8_t *origem, uint n, uint8_t *destino){
+    uint pos_codigo = 0, escrito = 1;
+    for(uint i = 0; i < n; i++){
+        if(origem[i]){
+            destino[escrito++] = origem[i];
+        }
+        if(!origem[i] || escrito - pos_codigo == 0xFF){
+            destino[pos_codigo] = escrito - pos_codigo;
+            pos_codigo = escrito++;
+        }
+    }
+    destino[pos_codigo] = escrito - pos_codigo;
+    return escrito;
+}
+
+static int cobs_decode_ref(const uint8_t *origem, uint n, uint8_t *destino){
+    uint lido = 0, escrito = 0;
+    while(lido < n){
+        uint codigo = origem[lido];
+        if(codigo == 0 || lido + codigo > n){
+            return -1;
+        }
+        memcpy(&destino[escrito], &origem[lido + 1], codigo - 1);
+        escrito += codigo - 1;
+        lido += codigo;
+        if(codigo < 0xFF && lido < n){
+            destino[escrito++] = 0;
+        }
+    }
+    return escrito;
+}
+
+static void entrega(const uint8_t *bytes, uint n){
+    for(uint i = 0; i < n; i++){
+        protocol_feed(bytes[i]);
+    }
+}
+
+// Monta e entrega um pedido: 0x00, COBS(comando, seq, dados, crc), 0x00
+static void envia(uint8_t comando, uint8_t seq, const uint8_t *dados, uint n){
+    static uint8_t quadro[PROTOCOL_MAX_DATA + 16];
+    static uint8_t codificado[sizeof(quadro) + 8];
+    quadro[0] = comando;
+    quadro[1] = seq;
+    memcpy(&quadro[2], dados, n);
+    uint32_t crc = crc32_ref(quadro, n + 2);
+    memcpy(&quadro[n + 2], &crc, sizeof(crc));
+    codificado[0] = 0;
+    uint tamanho = cobs_encode_ref(quadro, n + 6, &codificado[1]);
+    codificado[tamanho + 1] = 0;
+    saida_tamanho = 0;
+    escritas = 0;
+    entrega(codificado, tamanho + 2);
+}
+
+typedef struct {
+    uint8_t comando, seq, status;
+    uint8_t dados[PROTOCOL_MAX_DATA];
+    uint tamanho;
+} Resposta;
+
+// Decodifica a única resposta escrita desde o último envia(). Retorna false se não houver uma válida.
+static bool recebe(Resposta *r){
+    static uint8_t quadro[sizeof(saida)];
+    if(escritas != 1 || saida_tamanho < 3 || saida[0] || saida[saida_tamanho - 1]){
+        return false;
+    }
+    int n = cobs_decode_ref(&saida[1], saida_tamanho - 2, quadro);
+    if(n < 7){
+        return false;
+    }
+    uint32_t crc;
+    memcpy(&crc, &quadro[n - 4], sizeof(crc));
+    if(crc != crc32_ref(quadro, n - 4)){
+        return false;
+    }
+    r->comando = quadro[0];
+    r->seq = quadro[1];
+    r->status = quadro[2];
+    r->tamanho = n - 7;
+    memcpy(r->dados, &quadro[3], r->tamanho);
+    return true;
+}
+
+// Comando da aplicação: devolve os dados invertidos, ou ERR_ARGS sem dados
+static protocol_status_t inverte(const uint8_t *dados, uint tamanho, uint8_t *resposta, uint *tamanho_resposta){
+    if(!tamanho){
+        return PROTOCOL_ERR_ARGS;
+    }
+    for(uint i = 0; i < tamanho; i++){
+        resposta[i] = dados[tamanho - 1 - i];
+    }
+    *tamanho_resposta = tamanho;
+    return PROTOCOL_OK;
+}
+static const protocol_command_t comandos[] = {{0x42, inverte}};
+
+// TESTES =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// O CRC do firmware (tabela de 4 bits) é o mesmo do zlib
+static void teste_crc(void){
+    static const uint8_t texto[] = "123456789";
+    CONFERE(plan_store_crc32(texto, 9) == 0xCBF43926, "crc de \"123456789\": %08lx",
+            (unsigned long)plan_store_crc32(texto, 9));
+    uint8_t dados[300];
+    for(uint i = 0; i < sizeof(dados); i++){
+        dados[i] = i * 37 + 11;
+    }
+    for(uint n = 0; n <= sizeof(dados); n += 7){
+        CONFERE(plan_store_crc32(dados, n) == crc32_ref(dados, n), "crc de %u bytes", n);
+    }
+}
+
+// Pings de todos os tamanhos voltam iguais: dados sem zero (o maior bloco do COBS), com zeros e com 0xFF
+static void teste_ping(void){
+    static uint8_t dados[PROTOCOL_MAX_DATA];
+    Resposta r;
+    for(uint padrao = 0; padrao < 3; padrao++){
+        for(uint n = 0; n <= PROTOCOL_MAX_DATA; n++){
+            for(uint i = 0; i < n; i++){
+                dados[i] = padrao == 0 ? (uint8_t)(i * 7 + 1) : padrao == 1 ? (i % 5 ? 0xFF : 0) : (uint8_t)(i + 1) | 1;
+            }
+            uint8_t seq = n + padrao;
+            envia(PROTOCOL_CMD_PING, seq, dados, n);
+            if(!recebe(&r)){
+                CONFERE(false, "ping de %u bytes (padrao %u) sem resposta valida", n, padrao);
+                return;
+            }
+            CONFERE(r.comando == (PROTOCOL_CMD_PING | PROTOCOL_REPLY) && r.seq == seq && r.status == PROTOCOL_OK &&
+                    r.tamanho == n && !memcmp(r.dados, dados, n), "eco do ping de %u bytes (padrao %u)", n, padrao);
+        }
+    }
+}
+
+// Quadros corrompidos não têm resposta e entram nos contadores; o seguinte é atendido normalmente
+static void teste_erros(void){
+    protocol_stats_t antes = *protocol_stats();
+    Resposta r;
+
+    // CRC errado: um bit trocado nos dados depois da codificação
+    uint8_t quadro[16] = {PROTOCOL_CMD_PING, 1, 0x10, 0x20, 0x30};
+    uint32_t crc = crc32_ref(quadro, 5) ^ 1;
+    memcpy(&quadro[5], &crc, sizeof(crc));
+    uint8_t codificado[24] = {0};
+    uint n = cobs_encode_ref(quadro, 9, &codificado[1]);
+    saida_tamanho = escritas = 0;
+    entrega(codificado, n + 2);
+    CONFERE(escritas == 0, "quadro com CRC errado foi respondido");
+    CONFERE(protocol_stats()->erros_crc == antes.erros_crc + 1, "erro de CRC nao contado");
+
+    // COBS mal formado: código que passa do fim do quadro
+    static const uint8_t cobs_ruim[] = {0, 0x09, 1, 2, 0};
+    saida_tamanho = escritas = 0;
+    entrega(cobs_ruim, sizeof(cobs_ruim));
+    CONFERE(escritas == 0, "quadro com COBS mal formado foi respondido");
+    CONFERE(protocol_stats()->erros_cobs == antes.erros_cobs + 1, "erro de COBS nao contado");
+
+    // Estouro: bytes demais antes do delimitador são descartados até o próximo 0x00
+    static uint8_t longo[600];
+    memset(longo, 0x55, sizeof(longo));
+    saida_tamanho = escritas = 0;
+    entrega(longo, sizeof(longo));
+    protocol_feed(0);
+    CONFERE(escritas == 0, "quadro longo demais foi respondido");
+    CONFERE(protocol_stats()->estouros == antes.estouros + 1, "estouro nao contado");
+
+    static const uint8_t dados[] = {1, 0, 2};
+    envia(PROTOCOL_CMD_PING, 7, dados, sizeof(dados));
+    CONFERE(recebe(&r) && r.seq == 7 && r.tamanho == sizeof(dados), "ping depois dos erros");
+}
+
+// Comandos da aplicação, comando desconhecido e contadores do próprio protocolo
+static void teste_comandos(void){
+    Resposta r;
+    static const uint8_t dados[] = {1, 2, 0, 4};
+    envia(0x42, 3, dados, sizeof(dados));
+    CONFERE(recebe(&r) && r.status == PROTOCOL_OK && r.tamanho == 4 && r.dados[0] == 4 && r.dados[1] == 0 &&
+            r.dados[3] == 1, "comando da aplicacao");
+
+    envia(0x42, 4, NULL, 0);
+    CONFERE(recebe(&r) && r.status == PROTOCOL_ERR_ARGS && r.tamanho == 0, "erro do comando da aplicacao");
+
+    envia(0x55, 5, NULL, 0);
+    CONFERE(recebe(&r) && r.comando == (0x55 | PROTOCOL_REPLY) && r.status == PROTOCOL_ERR_UNKNOWN,
+            "comando desconhecido");
+
+    envia(PROTOCOL_CMD_STATS, 6, NULL, 0);
+    protocol_stats_t stats;
+    CONFERE(recebe(&r) && r.tamanho == sizeof(stats), "contadores do protocolo");
+    memcpy(&stats, r.dados, sizeof(stats));
+    CONFERE(stats.quadros_rx == protocol_stats()->quadros_rx, "quadros recebidos: %lu",
+            (unsigned long)stats.quadros_rx);
+}
+
+int main(void){
+    protocol_init(comandos, sizeof(comandos) / sizeof(comandos[0]));
+    teste_crc();
+    teste_ping();
+    teste_erros();
+    teste_comandos();
+    if(falhas){
+        printf("%u falha(s)\n", falhas);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
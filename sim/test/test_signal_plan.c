@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include "signal_plan.h"
+
+// Testes do motor de planos no host: só aritmética de prazos em ticks, sem escalonador (os
+// cabeçalhos do kernel dão o TickType_t e o pdMS_TO_TICKS do firmware). O relógio é o próprio
+// "agora" passado ao plan_start, escolhido perto da volta do contador de 32 bits.
+
+static uint falhas = 0;
+#define CONFERE(cond, ...) do{ \
+        if(!(cond)){ \
+            printf("FALHOU %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            falhas++; \
+        } \
+    }while(0)
+
+#define VIA 0
+#define PEDESTRE 1
+#define DIA_MS PLAN_INTERVAL_MAX_MS
+
+// Saídas chamadas pelo plano: quantidade (zerada por cada teste) e último estado de cada grupo
+static uint saidas = 0;
+static signal_state_t ultima[PLAN_MAX_GROUPS];
+
+static void saida(const plan_runner_t *r, uint grupo, signal_state_t estado){
+    saidas++;
+    ultima[grupo] = estado;
+}
+
+// TESTES =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+// Verde de 24 h começando perto da volta do contador: prazos e durações exatos em ticks
+static void teste_intervalo_de_24h(void){
+    const plan_t plano = PLAN(2,
+        {PLAN_GROUP(VIA, SIGNAL_GREEN), DIA_MS},
+        {PLAN_GROUP(VIA, SIGNAL_YELLOW), 5000},
+        {PLAN_GROUP(PEDESTRE, SIGNAL_GREEN), 10000},
+        {0, 1000});
+    plan_runner_t r;
+    TickType_t agora = 0xFFFFFFFFu - pdMS_TO_TICKS(1000);
+    saidas = 0;
+    plan_start(&r, &plano, agora, saida);
+    CONFERE(saidas == 2 && ultima[VIA] == SIGNAL_GREEN && ultima[PEDESTRE] == SIGNAL_RED, "partida: %u saidas", saidas);
+    CONFERE(plan_deadline(&r) - agora == pdMS_TO_TICKS(DIA_MS), "prazo do verde de 24 h: %lu ticks",
+            (unsigned long)(plan_deadline(&r) - agora));
+    CONFERE(plan_group_duration(&r, VIA) == pdMS_TO_TICKS(DIA_MS), "verde da via: %lu ticks",
+            (unsigned long)plan_group_duration(&r, VIA));
+    // O pedestre fica no vermelho pelo verde e pelo amarelo da via
+    CONFERE(plan_group_duration(&r, PEDESTRE) == pdMS_TO_TICKS(DIA_MS + 5000), "vermelho do pedestre: %lu ticks",
+            (unsigned long)plan_group_duration(&r, PEDESTRE));
+    CONFERE(plan_time_until(&r, PEDESTRE, SIGNAL_GREEN) == pdMS_TO_TICKS(5000), "ate a travessia: %lu ticks",
+            (unsigned long)plan_time_until(&r, PEDESTRE, SIGNAL_GREEN));
+    CONFERE(plan_time_until(&r, PEDESTRE, SIGNAL_FLASH) == portMAX_DELAY, "estado que nunca vem no ciclo");
+
+    // Um ciclo inteiro: o início de cada intervalo é o prazo do anterior, atravessando a volta
+    TickType_t ciclo = 0;
+    for(uint i = 0; i < plano.num_intervalos; i++){
+        ciclo += r.duracao;
+        saidas = 0;
+        plan_advance(&r);
+        CONFERE(saidas >= 1, "intervalo %u sem troca de saida", r.intervalo);
+    }
+    CONFERE(r.intervalo == 0 && r.inicio - agora == ciclo && ciclo == pdMS_TO_TICKS(DIA_MS + 16000),
+            "volta do ciclo: %lu ticks", (unsigned long)(r.inicio - agora));
+    CONFERE(ultima[VIA] == SIGNAL_GREEN && ultima[PEDESTRE] == SIGNAL_RED, "estados no inicio do segundo ciclo");
+}
+
+// Somas de muitos intervalos máximos: sem a volta dos 32 bits, saturadas em PLAN_TICKS_MAX
+static void teste_limite_das_somas(void){
+    static plan_interval_t intervalos[100];
+    for(uint i = 0; i < 99; i++){
+        intervalos[i] = (plan_interval_t){PLAN_GROUP(VIA, SIGNAL_GREEN), DIA_MS};
+    }
+    intervalos[99] = (plan_interval_t){PLAN_GROUP(VIA, SIGNAL_RED), DIA_MS};
+    plan_t plano = {intervalos, 100, 2};
+    plan_runner_t r;
+    plan_start(&r, &plano, 0, saida);
+    // 99 dias no verde e 98 dias até o vermelho passam dos 2^32 ms e da metade do contador de ticks
+    CONFERE(plan_group_duration(&r, VIA) == PLAN_TICKS_MAX, "99 dias de verde: %lu ticks",
+            (unsigned long)plan_group_duration(&r, VIA));
+    CONFERE(plan_time_until(&r, VIA, SIGNAL_RED) == PLAN_TICKS_MAX, "98 dias ate o vermelho: %lu ticks",
+            (unsigned long)plan_time_until(&r, VIA, SIGNAL_RED));
+
+    // Abaixo do limite a soma é exata: 24 dias no verde
+    plano.num_intervalos = 25;
+    intervalos[24].estados = PLAN_GROUP(VIA, SIGNAL_RED);
+    plan_start(&r, &plano, 0, saida);
+    CONFERE(plan_group_duration(&r, VIA) == pdMS_TO_TICKS((uint64_t)24 * DIA_MS), "24 dias de verde: %lu ticks",
+            (unsigned long)plan_group_duration(&r, VIA));
+    CONFERE(plan_time_until(&r, VIA, SIGNAL_RED) == pdMS_TO_TICKS((uint64_t)23 * DIA_MS), "23 dias ate o vermelho: %lu ticks",
+            (unsigned long)plan_time_until(&r, VIA, SIGNAL_RED));
+    intervalos[24].estados = PLAN_GROUP(VIA, SIGNAL_GREEN);
+}
+
+// plan_shorten só antecipa: prazos no fim ou depois dele não mudam nada, e um prazo antes do
+// início (também do outro lado da volta do contador) encerra o intervalo
+static void teste_encurtamento(void){
+    const plan_t plano = PLAN(2,
+        {PLAN_GROUP(VIA, SIGNAL_GREEN), DIA_MS},
+        {PLAN_GROUP(PEDESTRE, SIGNAL_GREEN), 4000});
+    plan_runner_t r;
+    TickType_t agora = 0xFFFFFFFFu - pdMS_TO_TICKS(2000);
+    plan_start(&r, &plano, agora, saida);
+    TickType_t prazo = plan_deadline(&r);
+
+    CONFERE(!plan_shorten(&r, prazo + 1) && plan_deadline(&r) == prazo, "prazo depois do fim nao encurta");
+    CONFERE(!plan_shorten(&r, prazo) && plan_deadline(&r) == prazo, "prazo igual ao fim nao encurta");
+
+    // Depois da volta do contador: 5 s após o início
+    CONFERE(plan_shorten(&r, agora + pdMS_TO_TICKS(5000)) && r.duracao == pdMS_TO_TICKS(5000),
+            "encurtado para 5 s: %lu ticks", (unsigned long)r.duracao);
+    CONFERE(plan_group_duration(&r, VIA) == pdMS_TO_TICKS(5000), "duracao do grupo com o intervalo encurtado");
+    CONFERE(!plan_shorten(&r, agora + pdMS_TO_TICKS(6000)), "um prazo posterior nao alonga o intervalo encurtado");
+    CONFERE(plan_shorten(&r, agora) && r.duracao == 0, "prazo no inicio encerra o intervalo");
+    plan_start(&r, &plano, agora, saida);
+    CONFERE(plan_shorten(&r, agora - 1) && r.duracao == 0, "prazo antes do inicio encerra o intervalo");
+
+    // O próximo intervalo começa no prazo encurtado
+    plan_start(&r, &plano, agora, saida);
+    plan_shorten(&r, agora + pdMS_TO_TICKS(5000));
+    plan_advance(&r);
+    CONFERE(r.inicio == agora + pdMS_TO_TICKS(5000) && ultima[PEDESTRE] == SIGNAL_GREEN &&
+            r.duracao == pdMS_TO_TICKS(4000), "intervalo seguinte ao encurtado");
+}
+
+int main(void){
+    teste_intervalo_de_24h();
+    teste_limite_das_somas();
+    teste_encurtamento();
+    if(falhas){
+        printf("%u falha(s)\n", falhas);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <string.h>
+#include "ssd1306.h"
+
+// Testes do ssd1306 sem o kernel: os periféricos são mocks deste arquivo. Cada entrada entregue
+// à I2C (pelo i2c_write_blocking dos comandos ou pela DMA do frame) é contada, e a DMA termina
+// na hora, chamando o handler da IRQ como o hardware faria.
+
+static uint falhas = 0;
+#define CONFERE(cond, ...) do{ \
+        if(!(cond)){ \
+            printf("FALHOU %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            falhas++; \
+        } \
+    }while(0)
+
+// MOCKS DOS PERIFÉRICOS =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+static i2c_hw_t i2c_hw[2] = {{.status = I2C_IC_STATUS_TFE_BITS}, {.status = I2C_IC_STATUS_TFE_BITS}};
+i2c_inst_t sim_i2c[2] = {{&i2c_hw[0], 0}, {&i2c_hw[1], 1}};
+static uint32_t bytes_i2c = 0;   // Entradas do IC_DATA_CMD desde o último zera_contagem
+static irq_handler_t dma_handler = NULL;
+static bool dma_irq_status = false;
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop){
+    bytes_i2c += len;
+    return len;
+}
+
+int dma_claim_unused_channel(bool required){
+    return 0;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel){
+    return (dma_channel_config){0};
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint32_t transfer_count, bool trigger){}
+
+void dma_channel_transfer_from_buffer_now(uint channel, const volatile void *read_addr, uint32_t transfer_count){
+    bytes_i2c += transfer_count;
+    dma_irq_status = true;
+    dma_handler();
+}
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled){}
+
+bool dma_channel_get_irq0_status(uint channel){
+    return dma_irq_status;
+}
+
+void dma_channel_acknowledge_irq0(uint channel){
+    dma_irq_status = false;
+}
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority){
+    dma_handler = handler;
+}
+
+void irq_set_enabled(uint num, bool enabled){}
+
+// TESTES =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+static ssd1306_t ssd;
+static ssd1306_buffers_t buffers;
+
+// Envia o frame e retorna quantas entradas foram para a I2C
+static uint32_t envia(void){
+    bytes_i2c = 0;
+    ssd1306_send_data(&ssd);
+    return bytes_i2c;
+}
+
+// Trocar um dígito da contagem envia só a janela dele, uma fração pequena do frame inteiro
+static void teste_troca_de_digito(void){
+    ssd1306_init_static(&ssd, false, 0x3C, i2c1, &buffers);
+    ssd1306_fill(&ssd, false);
+    ssd1306_rect(&ssd, 3, 3, 122, 60, true, false);
+    ssd1306_draw_string(&ssd, "VERDE", 8, 10, false);
+    ssd1306_draw_string(&ssd, "15", 105, 48, false);
+    uint32_t frame_inteiro = envia();
+    CONFERE(frame_inteiro >= SSD1306_BUFFER_SIZE, "o primeiro envio deveria ser o frame inteiro (%lu entradas)",
+            (unsigned long)frame_inteiro);
+
+    ssd1306_draw_string(&ssd, "14", 105, 48, false);
+    uint32_t digito = envia();
+    CONFERE(digito > 0, "a troca de digito nao foi enviada");
+    CONFERE(digito * 20 < frame_inteiro, "troca de digito: %lu entradas, frame inteiro: %lu",
+            (unsigned long)digito, (unsigned long)frame_inteiro);
+    printf("troca de digito: %lu entradas I2C, frame inteiro: %lu\n", (unsigned long)digito, (unsigned long)frame_inteiro);
+
+    // Redesenhar o mesmo conteúdo não envia nada
+    ssd1306_draw_string(&ssd, "14", 105, 48, false);
+    CONFERE(envia() == 0, "redesenhar o mesmo digito nao deveria enviar nada");
+}
+
+// Primitivas otimizadas contra as de referência (pixel a pixel): cada operação aleatória, dentro da
+// tela, é aplicada aos dois displays, que precisam terminar com buffers idênticos
+static ssd1306_t ssd_ref;
+static ssd1306_buffers_t buffers_ref;
+static uint32_t semente = 12345;
+
+static uint32_t aleatorio(uint32_t limite){
+    semente = semente * 1103515245u + 12345u;
+    return (semente >> 16) % limite;
+}
+
+static void teste_referencia(void){
+    static const char caracteres[] = "0123456789ABCXYZabcxyz*!.:<>-,+ ";
+    ssd1306_init_static(&ssd, false, 0x3C, i2c1, &buffers);
+    ssd1306_init_static(&ssd_ref, false, 0x3C, i2c1, &buffers_ref);
+    // Fundo aleatório igual nos dois, para exercitar tanto acender quanto apagar
+    for(uint i = 1; i <= SSD1306_BUFFER_SIZE; i++){
+        ssd.ram_buffer[i] = ssd_ref.ram_buffer[i] = aleatorio(256);
+    }
+
+    for(uint i = 0; i < 5000; i++){
+        bool valor = aleatorio(2);
+        uint8_t x0 = aleatorio(WIDTH), y0 = aleatorio(HEIGHT);
+        uint8_t x1 = x0 + aleatorio(WIDTH - x0), y1 = y0 + aleatorio(HEIGHT - y0);
+        uint operacao = aleatorio(5);
+        switch(operacao){
+            case 0:
+                ssd1306_hline(&ssd, x0, x1, y0, valor);
+                ssd1306_hline_ref(&ssd_ref, x0, x1, y0, valor);
+                break;
+            case 1:
+                ssd1306_vline(&ssd, x0, y0, y1, valor);
+                ssd1306_vline_ref(&ssd_ref, x0, y0, y1, valor);
+                break;
+            case 2:{
+                bool preenche = aleatorio(2);
+                ssd1306_rect(&ssd, y0, x0, x1 - x0 + 1, y1 - y0 + 1, valor, preenche);
+                ssd1306_rect_ref(&ssd_ref, y0, x0, x1 - x0 + 1, y1 - y0 + 1, valor, preenche);
+                break;
+            }
+            case 3:{
+                char c = caracteres[aleatorio(sizeof(caracteres) - 1)];
+                x0 = aleatorio(WIDTH - 7);
+                y0 = aleatorio(HEIGHT - 7);
+                ssd1306_draw_char(&ssd, c, x0, y0, valor);
+                ssd1306_draw_char_ref(&ssd_ref, c, x0, y0, valor);
+                break;
+            }
+            default:
+                // O fill apaga todo o resto: raro, para não esconder as outras operações
+                if(aleatorio(50) == 0){
+                    ssd1306_fill(&ssd, valor);
+                    ssd1306_fill_ref(&ssd_ref, valor);
+                }
+                break;
+        }
+        if(memcmp(&ssd.ram_buffer[1], &ssd_ref.ram_buffer[1], SSD1306_BUFFER_SIZE)){
+            CONFERE(false, "operacao %u (valor %d, x %u..%u, y %u..%u) difere da referencia na iteracao %u",
+                    operacao, valor, x0, x1, y0, y1, i);
+            return;
+        }
+    }
+    printf("primitivas iguais as de referencia em 5000 operacoes\n");
+}
+
+// Com bytes ainda na FIFO da I2C o display está ocupado, mesmo que o ACTIVITY leia 0 entre dois bytes
+static void teste_fifo_da_i2c(void){
+    ssd1306_init_static(&ssd, false, 0x3C, i2c1, &buffers);
+    i2c_hw[1].status = 0;
+    CONFERE(ssd1306_busy(&ssd), "FIFO com entradas e ACTIVITY em 0 deveria contar como ocupado");
+    i2c_hw[1].status = I2C_IC_STATUS_TFE_BITS | I2C_IC_STATUS_ACTIVITY_BITS;
+    CONFERE(ssd1306_busy(&ssd), "FIFO vazia com o ultimo byte saindo deveria contar como ocupado");
+    i2c_hw[1].status = I2C_IC_STATUS_TFE_BITS;
+    CONFERE(!ssd1306_busy(&ssd), "FIFO vazia e sem atividade deveria estar livre");
+}
+
+int main(void){
+    teste_fifo_da_i2c();
+    teste_troca_de_digito();
+    teste_referencia();
+    if(falhas){
+        printf("%u falha(s)\n", falhas);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
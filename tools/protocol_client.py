@@ -0,0 +1,268 @@
+#!/usr/bin/env python3
+"""Cliente de referência do protocolo binário do semáforo (lib/protocol.h).
+
+Fala com a placa pela porta serial USB/UART (pyserial) ou com o simulador, que é
+iniciado num pipe com SIM_STDIN=1:
+    python3 tools/protocol_client.py --porta /dev/ttyACM0 estado
+    python3 tools/protocol_client.py --sim build-sim/SemaforoSim vazao 2000 64
+O texto dos printf que chega entre os quadros vai para o stderr (ou para o stdout no
+comando trace, para ser salvo e lido pelo tools/trace_decode.py).
+"""
+import argparse
+import os
+import select
+import struct
+import subprocess
+import sys
+import time
+import zlib
+
+CMD_PING = 0x00
+CMD_ESTADO = 0x01
+CMD_CONTADORES = 0x02
+CMD_MODO_NOTURNO = 0x03
+CMD_PLANO_INTERVALO = 0x04
+CMD_RELOGIO = 0x05
+CMD_TRACE = 0x06
+CMD_STATS = 0x7F
+REPLY = 0x80
+MAX_DADOS = 240
+
+STATUS = {0: "OK", 1: "comando desconhecido", 2: "argumentos invalidos", 3: "ocupado", 4: "falhou"}
+FASES = {0: "VERDE", 1: "AMARELO", 2: "VERMELHO"}
+SINAIS = {0: "VERMELHO", 1: "VERDE", 2: "AMARELO", 3: "PISCANTE"}
+
+# Layouts das respostas (mesmas structs do firmware, little-endian)
+ESTADO = struct.Struct("<4B4I2H")
+CONTADORES = struct.Struct("<5I")
+STATS = struct.Struct("<6I")
+
+
+def cobs_encode(dados):
+    saida = bytearray(b"\x00")
+    pos_codigo = 0
+    for byte in dados:
+        if byte:
+            saida.append(byte)
+        if not byte or len(saida) - pos_codigo == 0xFF:
+            saida[pos_codigo] = len(saida) - pos_codigo
+            pos_codigo = len(saida)
+            saida.append(0)
+    saida[pos_codigo] = len(saida) - pos_codigo
+    return bytes(saida)
+
+
+def cobs_decode(dados):
+    saida = bytearray()
+    i = 0
+    while i < len(dados):
+        codigo = dados[i]
+        if codigo == 0 or i + codigo > len(dados):
+            raise ValueError("COBS mal formado")
+        saida += dados[i + 1:i + codigo]
+        i += codigo
+        if codigo < 0xFF and i < len(dados):
+            saida.append(0)
+    return bytes(saida)
+
+
+class Erro(Exception):
+    pass
+
+
+class Link:
+    """Quadros sobre um fluxo de bytes; o texto entre quadros vai para a função texto."""
+
+    def __init__(self, ler, escrever, texto):
+        self.ler = ler
+        self.escrever = escrever
+        self.texto = texto
+        self.buffer = bytearray()
+        self.seq = 0
+
+    def envia(self, comando, dados=b""):
+        self.seq = (self.seq + 1) & 0xFF
+        quadro = bytes([comando, self.seq]) + dados
+        quadro += struct.pack("<I", zlib.crc32(quadro))
+        self.escrever(b"\x00" + cobs_encode(quadro) + b"\x00")
+        return self.seq
+
+    def recebe(self, timeout=2.0):
+        """Próxima resposta válida: (comando, seq, status, dados)."""
+        limite = time.monotonic() + timeout
+        while True:
+            while b"\x00" in self.buffer:
+                fim = self.buffer.index(b"\x00")
+                trecho = bytes(self.buffer[:fim])
+                del self.buffer[:fim + 1]
+                resposta = self.decodifica(trecho)
+                if resposta:
+                    return resposta
+            restante = limite - time.monotonic()
+            if restante <= 0:
+                raise Erro("sem resposta")
+            novos = self.ler(restante)
+            if novos is None:
+                raise Erro("conexao encerrada")
+            self.buffer += novos
+
+    def decodifica(self, trecho):
+        if not trecho:
+            return None
+        try:
+            quadro = cobs_decode(trecho)
+            if len(quadro) >= 7 and quadro[0] & REPLY and \
+                    zlib.crc32(quadro[:-4]) == struct.unpack("<I", quadro[-4:])[0]:
+                return quadro[0] & ~REPLY, quadro[1], quadro[2], quadro[3:-4]
+        except ValueError:
+            pass
+        # Não é quadro: texto dos printf entre dois quadros
+        self.texto(trecho.decode("utf-8", "replace"))
+        return None
+
+    def comando(self, comando, dados=b"", timeout=2.0):
+        seq = self.envia(comando, dados)
+        while True:
+            cmd, seq_resposta, status, resposta = self.recebe(timeout)
+            if cmd == comando and seq_resposta == seq:
+                if status:
+                    raise Erro(STATUS.get(status, "status %d" % status))
+                return resposta
+
+
+def abre_serial(porta, texto):
+    import serial  # pyserial, só necessário para a placa
+    s = serial.Serial(porta, 115200, timeout=0)
+
+    def ler(timeout):
+        select.select([s], [], [], timeout)
+        return s.read(4096)
+    return Link(ler, s.write, texto)
+
+
+def abre_sim(executavel, texto):
+    env = dict(os.environ, SIM_STDIN="1", SIM_LOG=os.environ.get("SIM_LOG", ""))
+    proc = subprocess.Popen([executavel], stdin=subprocess.PIPE, stdout=subprocess.PIPE, env=env)
+    saida = proc.stdout.fileno()
+
+    def ler(timeout):
+        prontos, _, _ = select.select([saida], [], [], timeout)
+        if not prontos:
+            return b""
+        dados = os.read(saida, 65536)
+        return dados if dados else None
+
+    def escrever(dados):
+        proc.stdin.write(dados)
+        proc.stdin.flush()
+    return Link(ler, escrever, texto)
+
+
+def estado(link, args):
+    campos = ESTADO.unpack(link.comando(CMD_ESTADO))
+    noturno, fase, plano, intervalo, restante, estados, versao, tempo, minuto, chamada = campos
+    print("modo: %s" % ("NOTURNO" if noturno else "NORMAL"))
+    print("fase da placa: %s, restam %.1f s" % (FASES.get(fase, fase), restante / 1000))
+    print("plano %d (versao %d), intervalo %d, relogio %02d:%02d" % (plano, versao, intervalo, minuto // 60, minuto % 60))
+    print("grupos: %s" % ", ".join("%d %s" % (g, SINAIS[(estados >> 2 * g) & 3]) for g in range(3)))
+    print("chamada de pedestre pendente: %s" % ("sim" if chamada else "nao"))
+    print("tempo desde o boot: %.1f s" % (tempo / 1000))
+
+
+def contadores(link, args):
+    chamadas, media, pior, reacao, transicao = CONTADORES.unpack(link.comando(CMD_CONTADORES))
+    print("chamadas atendidas: %d, espera media %d ms, pior %d ms" % (chamadas, media, pior))
+    print("pior reacao a chamada: %d us" % reacao)
+    print("pior transicao de fase: %d us (build com SEMAFORO_LATENCY_STATS)" % transicao)
+    rx, quadros_rx, quadros_tx, cobs, crc, estouros = STATS.unpack(link.comando(CMD_STATS))
+    print("protocolo: %d bytes e %d quadros recebidos, %d enviados, erros: %d COBS, %d CRC, %d estouros"
+          % (rx, quadros_rx, quadros_tx, cobs, crc, estouros))
+
+
+def noturno(link, args):
+    link.comando(CMD_MODO_NOTURNO, bytes([args.ligado == "on"]))
+
+
+def intervalo(link, args):
+    versao = struct.unpack("<I", link.comando(CMD_PLANO_INTERVALO, struct.pack("<BBI", args.plano, args.intervalo, args.ms)))[0]
+    print("planos gravados: versao %d (o plano muda no fim do ciclo)" % versao)
+
+
+def relogio(link, args):
+    hora, minuto = (int(x) for x in args.hora.split(":"))
+    link.comando(CMD_RELOGIO, struct.pack("<H", hora * 60 + minuto))
+
+
+def trace(link, args):
+    link.texto = sys.stdout.write
+    link.comando(CMD_TRACE, timeout=10.0)
+
+
+def vazao(link, args):
+    """Pings com args.tamanho bytes, com até args.janela pedidos em trânsito."""
+    dados = bytes((i * 7 + 1) & 0xFF for i in range(args.tamanho))
+    pendentes = {}
+    rtts = []
+    enviados = 0
+    inicio = time.monotonic()
+    while len(rtts) < args.quadros:
+        while enviados < args.quadros and len(pendentes) < args.janela:
+            pendentes[link.envia(CMD_PING, dados)] = time.monotonic()
+            enviados += 1
+        cmd, seq, status, resposta = link.recebe()
+        if cmd != CMD_PING or seq not in pendentes:
+            continue
+        if status or resposta != dados:
+            raise Erro("eco incorreto no quadro %d" % seq)
+        rtts.append(time.monotonic() - pendentes.pop(seq))
+    duracao = time.monotonic() - inicio
+    rtts.sort()
+    print("%d quadros de %d bytes em %.3f s: %.0f quadros/s, %.1f KB/s de dados em cada sentido"
+          % (args.quadros, args.tamanho, duracao, args.quadros / duracao, args.quadros * args.tamanho / duracao / 1024))
+    print("ida e volta: mediana %.2f ms, p99 %.2f ms, pior %.2f ms"
+          % (rtts[len(rtts) // 2] * 1e3, rtts[int(len(rtts) * 0.99)] * 1e3, rtts[-1] * 1e3))
+    _, _, _, cobs, crc, estouros = STATS.unpack(link.comando(CMD_STATS))
+    print("erros no alvo: %d COBS, %d CRC, %d estouros" % (cobs, crc, estouros))
+    if cobs or crc or estouros:
+        raise Erro("quadros perdidos no alvo")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    alvo = parser.add_mutually_exclusive_group(required=True)
+    alvo.add_argument("--porta", help="porta serial da placa (ex.: /dev/ttyACM0)")
+    alvo.add_argument("--sim", help="executavel SemaforoSim")
+    sub = parser.add_subparsers(dest="comando", required=True)
+    sub.add_parser("estado").set_defaults(func=estado)
+    sub.add_parser("contadores").set_defaults(func=contadores)
+    p = sub.add_parser("noturno")
+    p.add_argument("ligado", choices=["on", "off"])
+    p.set_defaults(func=noturno)
+    p = sub.add_parser("intervalo", help="altera a duracao de um intervalo de um plano")
+    p.add_argument("plano", type=int)
+    p.add_argument("intervalo", type=int)
+    p.add_argument("ms", type=int)
+    p.set_defaults(func=intervalo)
+    p = sub.add_parser("relogio", help="acerta o relogio do dia (HH:MM)")
+    p.add_argument("hora")
+    p.set_defaults(func=relogio)
+    sub.add_parser("trace", help="dump do trace (build com SEMAFORO_TRACE)").set_defaults(func=trace)
+    p = sub.add_parser("vazao", help="teste de vazao com pings")
+    p.add_argument("quadros", type=int, nargs="?", default=1000)
+    p.add_argument("tamanho", type=int, nargs="?", default=64)
+    p.add_argument("--janela", type=int, default=4, help="pedidos em transito")
+    p.set_defaults(func=vazao)
+    args = parser.parse_args()
+    if args.comando == "vazao" and not 0 <= args.tamanho <= MAX_DADOS:
+        parser.error("tamanho de 0 a %d bytes" % MAX_DADOS)
+
+    texto = sys.stderr.write
+    link = abre_serial(args.porta, texto) if args.porta else abre_sim(args.sim, texto)
+    try:
+        args.func(link, args)
+    except Erro as e:
+        sys.exit("erro: %s" % e)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,193 @@
+#!/usr/bin/env python3
+"""Decodifica o dump do trace do semáforo (build com SEMAFORO_TRACE).
+
+Captura: peça o dump pelo protocolo e salve a saída, por exemplo
+    python3 tools/protocol_client.py --porta /dev/ttyACM0 trace > captura.txt
+    python3 tools/trace_decode.py captura.txt > trace.json
+e abra o trace.json no chrome://tracing ou no https://ui.perfetto.dev.
+Com --text, imprime uma linha do tempo legível.
+"""
+import argparse
+import json
+import sys
+
+# Mesmos valores do trace_event_t em lib/trace.h
+TASK_IN = 1
+FASE = 2
+MODO = 3
+BOTAO_BORDA = 4
+DISPLAY_INICIO = 5
+DISPLAY_FIM = 6
+MATRIZ_DMA_FIM = 7
+MATRIZ_LATCH = 8
+GRUPO = 9
+PEDESTRE = 10
+
+NOMES = {
+    TASK_IN: "task",
+    FASE: "fase",
+    MODO: "modo",
+    BOTAO_BORDA: "botao",
+    DISPLAY_INICIO: "display inicio",
+    DISPLAY_FIM: "display fim",
+    MATRIZ_DMA_FIM: "matriz dma fim",
+    MATRIZ_LATCH: "matriz latch",
+    GRUPO: "grupo",
+    PEDESTRE: "pedestre",
+}
+FASES = {0: "VERDE", 1: "AMARELO", 2: "VERMELHO"}
+# signal_state_t de lib/signal_plan.h
+SINAIS = {0: "VERMELHO", 1: "VERDE", 2: "AMARELO", 3: "PISCANTE"}
+
+# Linhas (tid) do trace que não são cores
+TID_FASE = 10
+TID_BOTAO = 11
+TID_DISPLAY = 12
+TID_MATRIZ = 13
+TID_GRUPO = 20  # Uma linha por grupo de sinal a partir daqui
+
+
+def le_dump(linhas):
+    """Retorna (tasks, registros) do último bloco TRACE BEGIN/END."""
+    bloco = None
+    ultimo = None
+    for linha in linhas:
+        linha = linha.strip()
+        if linha == "TRACE BEGIN":
+            bloco = []
+        elif linha == "TRACE END" and bloco is not None:
+            ultimo = bloco
+            bloco = None
+        elif bloco is not None:
+            bloco.append(linha)
+    if ultimo is None:
+        sys.exit("nenhum bloco TRACE BEGIN/END completo na entrada")
+
+    tasks = {}
+    registros = []
+    for linha in ultimo:
+        partes = linha.split(" ", 2)
+        if partes[0] == "TASK":
+            tasks[int(partes[1])] = partes[2]
+        elif partes[0] == "REC":
+            core, tempo, tipo, arg = linha.split()[1:]
+            registros.append((int(core), int(tempo, 16), int(tipo, 16), int(arg, 16)))
+    return tasks, registros
+
+
+def desfaz_volta(registros):
+    """Converte os tempos de 32 bits em us relativos, desfazendo a volta do contador.
+
+    Todos os eventos do anel ficam a menos de ~35 min do último registro, então a
+    diferença com sinal em 32 bits até ele é exata.
+    """
+    if not registros:
+        return []
+    ancora = registros[-1][1]
+    convertidos = []
+    for core, tempo, tipo, arg in registros:
+        delta = ((tempo - ancora + (1 << 31)) & 0xFFFFFFFF) - (1 << 31)
+        convertidos.append((delta, core, tipo, arg))
+    convertidos.sort(key=lambda r: r[0])
+    inicio = convertidos[0][0]
+    return [(t - inicio, core, tipo, arg) for t, core, tipo, arg in convertidos]
+
+
+def nome_task(tasks, numero):
+    return tasks.get(numero, "task %d" % numero)
+
+
+def chrome(tasks, eventos):
+    saida = []
+    # Nomes das linhas
+    for tid, nome in [(0, "core 0"), (1, "core 1"), (TID_FASE, "fase"), (TID_BOTAO, "botao"),
+                      (TID_DISPLAY, "display DMA"), (TID_MATRIZ, "matriz")]:
+        saida.append({"ph": "M", "name": "thread_name", "pid": 0, "tid": tid, "args": {"name": nome}})
+
+    fim = eventos[-1][0] if eventos else 0
+    abertos = {}  # Fatia aberta por linha: (inicio, nome)
+    grupos = set()
+
+    def abre(tid, t, nome):
+        fecha(tid, t)
+        abertos[tid] = (t, nome)
+
+    def fecha(tid, t):
+        if tid in abertos:
+            inicio, nome = abertos.pop(tid)
+            saida.append({"ph": "X", "name": nome, "pid": 0, "tid": tid, "ts": inicio, "dur": t - inicio})
+
+    def instante(tid, t, nome, args=None):
+        saida.append({"ph": "i", "s": "t", "name": nome, "pid": 0, "tid": tid, "ts": t, "args": args or {}})
+
+    for t, core, tipo, arg in eventos:
+        if tipo == TASK_IN:
+            abre(core, t, nome_task(tasks, arg))
+        elif tipo == FASE:
+            abre(TID_FASE, t, FASES.get(arg, "fase %d" % arg))
+        elif tipo == MODO:
+            instante(TID_FASE, t, "NOTURNO" if arg else "NORMAL")
+        elif tipo == BOTAO_BORDA:
+            instante(TID_BOTAO, t, "borda", {"nivel": arg})
+        elif tipo == DISPLAY_INICIO:
+            abre(TID_DISPLAY, t, "flush %d palavras" % arg)
+        elif tipo == DISPLAY_FIM:
+            fecha(TID_DISPLAY, t)
+        elif tipo == MATRIZ_DMA_FIM:
+            instante(TID_MATRIZ, t, "dma fim")
+        elif tipo == MATRIZ_LATCH:
+            instante(TID_MATRIZ, t, "latch")
+        elif tipo == GRUPO:
+            tid = TID_GRUPO + (arg >> 8)
+            if tid not in grupos:
+                grupos.add(tid)
+                saida.append({"ph": "M", "name": "thread_name", "pid": 0, "tid": tid,
+                              "args": {"name": "grupo %d" % (arg >> 8)}})
+            abre(tid, t, SINAIS.get(arg & 0xFF, str(arg & 0xFF)))
+        elif tipo == PEDESTRE:
+            if arg:
+                instante(TID_BOTAO, t, "travessia", {"espera_ms": arg})
+            else:
+                instante(TID_BOTAO, t, "chamada")
+    for tid in list(abertos):
+        fecha(tid, fim)
+    return {"traceEvents": saida, "displayTimeUnit": "ms"}
+
+
+def texto(tasks, eventos):
+    linhas = []
+    for t, core, tipo, arg in eventos:
+        if tipo == TASK_IN:
+            detalhe = nome_task(tasks, arg)
+        elif tipo == FASE:
+            detalhe = FASES.get(arg, str(arg))
+        elif tipo == MODO:
+            detalhe = "NOTURNO" if arg else "NORMAL"
+        elif tipo == GRUPO:
+            detalhe = "%d %s" % (arg >> 8, SINAIS.get(arg & 0xFF, str(arg & 0xFF)))
+        elif tipo == PEDESTRE:
+            detalhe = "travessia apos %d ms" % arg if arg else "chamada"
+        else:
+            detalhe = str(arg)
+        linhas.append("%12.3f ms  core %d  %-15s %s" % (t / 1000.0, core, NOMES.get(tipo, "tipo %d" % tipo), detalhe))
+    return "\n".join(linhas)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("entrada", nargs="?", help="captura do stdio (padrão: entrada padrão)")
+    parser.add_argument("--text", action="store_true", help="linha do tempo em texto em vez de JSON do Chrome")
+    args = parser.parse_args()
+
+    arquivo = open(args.entrada, errors="replace") if args.entrada else sys.stdin
+    tasks, registros = le_dump(arquivo)
+    eventos = desfaz_volta(registros)
+    if args.text:
+        print(texto(tasks, eventos))
+    else:
+        json.dump(chrome(tasks, eventos), sys.stdout, indent=1)
+        print()
+
+
+if __name__ == "__main__":
+    main()